@@ -0,0 +1,61 @@
+#include "graph.hxx"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <list>
+#include <string>
+
+using namespace LP_MP;
+
+// times construction of graphs with uniformly random edges.
+// usage: graph_construction_benchmark [no_edges ...], default 10^6, 10^7 and 10^8 edges.
+
+std::vector<std::array<std::size_t,2>> random_edges(const std::size_t no_nodes, const std::size_t no_edges)
+{
+   std::mt19937_64 gen(no_edges);
+   std::uniform_int_distribution<std::size_t> node_dist(0, no_nodes-1);
+   std::vector<std::array<std::size_t,2>> edges;
+   edges.reserve(no_edges);
+   while(edges.size() < no_edges) {
+      const std::size_t i = node_dist(gen);
+      const std::size_t j = node_dist(gen);
+      if(i != j) { edges.push_back({std::min(i,j), std::max(i,j)}); }
+   }
+   std::sort(edges.begin(), edges.end());
+   edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+   return edges;
+}
+
+// best of several runs, so that first touch of freshly allocated memory does not distort timings
+template<typename F>
+double time_ms(F f, const std::size_t no_runs = 3)
+{
+   double best = std::numeric_limits<double>::infinity();
+   for(std::size_t r=0; r<no_runs; ++r) {
+      const auto begin = std::chrono::steady_clock::now();
+      f();
+      const auto end = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double, std::milli>(end - begin).count());
+   }
+   return best;
+}
+
+int main(int argc, char** argv)
+{
+   std::vector<std::size_t> sizes;
+   for(int i=1; i<argc; ++i) { sizes.push_back(std::stoull(argv[i])); }
+   if(sizes.empty()) { sizes = {1000000, 10000000, 100000000}; }
+
+   struct empty {};
+   for(const std::size_t no_edges : sizes) {
+      const auto edges = random_edges(no_edges/8, no_edges);
+      std::cout << "edges = " << edges.size() << "\n";
+
+      const double parallel_time = time_ms([&]() { graph<empty> g(edges.begin(), edges.end()); });
+      std::cout << "  random access construction: " << parallel_time << " ms\n";
+
+      std::list<std::array<std::size_t,2>> edge_list(edges.begin(), edges.end());
+      const double sequential_time = time_ms([&]() { graph<empty> g(edge_list.begin(), edge_list.end()); });
+      std::cout << "  forward iterator construction: " << sequential_time << " ms\n";
+   }
+}
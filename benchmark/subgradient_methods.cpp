@@ -0,0 +1,77 @@
+#include "LP_MP.h"
+#include "test_model.hxx"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+using namespace LP_MP;
+
+// time until the lower bound of LP_subgradient_ascent comes within a relative gap of the best lower bound found by any method.
+// usage: subgradient_methods_benchmark [iterations], default 500.
+
+struct trace {
+   std::vector<double> time; // ms
+   std::vector<REAL> lower_bound;
+};
+
+template<typename BUILD_FUNC>
+trace run(const std::string& method, BUILD_FUNC build, const INDEX no_iterations)
+{
+   TCLAP::CmdLine cmd("subgradient methods benchmark");
+   LP_subgradient_ascent<test_FMC> lp(cmd);
+   std::vector<std::string> args = {"subgradient_methods_benchmark", "--subgradientMethod", method};
+   cmd.parse(args);
+   build(lp);
+
+   trace t;
+   const auto begin = std::chrono::steady_clock::now();
+   for(INDEX iter=0; iter<no_iterations; ++iter) {
+      lp.ComputePass(iter);
+      const REAL lb = lp.decomposition_lower_bound();
+      t.time.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+      t.lower_bound.push_back(std::max(lb, t.lower_bound.empty() ? lb : t.lower_bound.back()));
+   }
+   return t;
+}
+
+template<typename BUILD_FUNC>
+void compare(const std::string& name, BUILD_FUNC build, const INDEX no_iterations)
+{
+   const std::vector<std::string> methods = {"standard", "polyak", "nesterov", "averaged"};
+   std::vector<trace> traces;
+   REAL best = -std::numeric_limits<REAL>::infinity();
+   for(const auto& m : methods) {
+      traces.push_back(run(m, build, no_iterations));
+      best = std::max(best, traces.back().lower_bound.back());
+   }
+
+   std::cout << name << ": best lower bound " << best << "\n";
+   for(std::size_t i=0; i<methods.size(); ++i) {
+      std::cout << "  " << methods[i] << ": final " << traces[i].lower_bound.back();
+      for(const REAL gap : {1e-2, 1e-3}) {
+         const REAL threshold = best - gap * std::max(REAL(1.0), std::abs(best));
+         const auto it = std::find_if(traces[i].lower_bound.begin(), traces[i].lower_bound.end(), [=](const REAL lb) { return lb >= threshold; });
+         std::cout << ", gap " << gap << ": ";
+         if(it == traces[i].lower_bound.end()) {
+            std::cout << "not reached";
+         } else {
+            const std::size_t k = it - traces[i].lower_bound.begin();
+            std::cout << traces[i].time[k] << " ms (" << k+1 << " iterations)";
+         }
+      }
+      std::cout << "\n";
+   }
+}
+
+int main(int argc, char** argv)
+{
+   const INDEX no_iterations = argc > 1 ? std::stoul(argv[1]) : 500;
+   compare("test model", [](auto& lp) { build_test_model(lp); }, no_iterations);
+   compare("grid 30x30", [](auto& lp) { build_grid(lp, 30, 30); }, no_iterations);
+   compare("grid 100x100", [](auto& lp) { build_grid(lp, 100, 100); }, no_iterations);
+}
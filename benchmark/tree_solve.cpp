@@ -0,0 +1,116 @@
+#include "LP_MP.h"
+#include "test_model.hxx"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <cmath>
+#include <limits>
+
+using namespace LP_MP;
+
+// compares factor_tree::solve with dispatching every message through std::visit on chains and on the row trees of a grid.
+// usage: tree_solve_benchmark [no_factors ...], default 10^5 and 10^6 factors.
+
+// message passing on the tree as done before messages were compiled into a schedule
+template<typename FMC>
+REAL visit_solve(factor_tree<FMC>& t)
+{
+   for(auto& tree_msg : t.tree_messages_) {
+      const Chirality c = std::get<1>(tree_msg);
+      std::visit([c](auto&& msg) { msg.send_message_up(c); }, std::get<0>(tree_msg));
+   }
+   REAL value = 0.0;
+   {
+      const Chirality c = std::get<1>(t.tree_messages_.back());
+      std::visit([&](auto&& msg) {
+            auto* f = c == Chirality::right ? msg.GetRightFactorTypeAdapter() : msg.GetLeftFactorTypeAdapter();
+            f->init_primal();
+            f->MaximizePotentialAndComputePrimal();
+            value = f->EvaluatePrimal();
+            }, std::get<0>(t.tree_messages_.back()));
+   }
+   for(auto it = t.tree_messages_.rbegin(); it != t.tree_messages_.rend(); ++it) {
+      const Chirality c = std::get<1>(*it);
+      std::visit([&](auto&& msg) {
+            msg.track_solution_down(c);
+            value += c == Chirality::right ? msg.GetLeftFactorTypeAdapter()->EvaluatePrimal() : msg.GetRightFactorTypeAdapter()->EvaluatePrimal();
+            }, std::get<0>(*it));
+   }
+   return value;
+}
+
+template<typename F>
+double time_ms(F f)
+{
+   double best = std::numeric_limits<double>::max();
+   for(int k=0; k<3; ++k) {
+      const auto begin = std::chrono::steady_clock::now();
+      f();
+      const auto end = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double, std::milli>(end - begin).count());
+   }
+   return best;
+}
+
+// trees of chain_length factors each, connected from first to last factor
+std::vector<factor_tree<test_FMC>> build_chains(LP<test_FMC>& lp, const std::size_t no_chains, const std::size_t chain_length)
+{
+   std::mt19937 gen(no_chains * chain_length);
+   std::uniform_real_distribution<REAL> cost(-1.0, 1.0);
+   std::vector<factor_tree<test_FMC>> trees(no_chains);
+   for(auto& t : trees) {
+      auto* prev = lp.add_factor<test_FMC::factor>(cost(gen), cost(gen));
+      for(std::size_t i=1; i<chain_length; ++i) {
+         auto* f = lp.add_factor<test_FMC::factor>(cost(gen), cost(gen));
+         t.add_message(lp.add_message<test_FMC::message>(prev, f), Chirality::right);
+         prev = f;
+      }
+      t.populate_factors();
+   }
+   return trees;
+}
+
+int run(const std::string& name, std::vector<factor_tree<test_FMC>>& trees)
+{
+   REAL visit_value = 0.0;
+   const double visit_time = time_ms([&]() {
+         visit_value = 0.0;
+         for(auto& t : trees) { visit_value += visit_solve(t); }
+         });
+   REAL value = 0.0;
+   const double schedule_time = time_ms([&]() {
+         value = 0.0;
+         for(auto& t : trees) { value += t.solve(); }
+         });
+   std::cout << "  " << name << ": std::visit " << visit_time << " ms, compiled schedule " << schedule_time << " ms\n";
+   if(std::abs(value - visit_value) > eps * std::max(REAL(1.0), std::abs(value))) {
+      std::cout << "  tree costs differ: " << visit_value << " != " << value << "\n";
+      return 1;
+   }
+   return 0;
+}
+
+int main(int argc, char** argv)
+{
+   std::vector<std::size_t> sizes;
+   for(int i=1; i<argc; ++i) { sizes.push_back(std::stoull(argv[i])); }
+   if(sizes.empty()) { sizes = {100000, 1000000}; }
+
+   for(const std::size_t n : sizes) {
+      std::cout << "factors = " << n << "\n";
+      {
+         TCLAP::CmdLine cmd("tree solve benchmark");
+         LP<test_FMC> lp(cmd);
+         auto trees = build_chains(lp, 1, n);
+         if(run("chain", trees)) { return 1; }
+      }
+      {
+         TCLAP::CmdLine cmd("tree solve benchmark");
+         LP<test_FMC> lp(cmd);
+         const std::size_t width = std::max(std::size_t(2), std::size_t(std::sqrt(n)));
+         auto trees = build_chains(lp, n / width, width);
+         if(run("grid rows", trees)) { return 1; }
+      }
+   }
+}
@@ -0,0 +1,53 @@
+#include "union_find.hxx"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <array>
+#include <string>
+
+using namespace LP_MP;
+
+// compares sequential and concurrent union find on random merges.
+// usage: union_find_benchmark [no_elements ...], default 10^6 and 10^7 elements with as many merges.
+
+template<typename F>
+double time_ms(F f)
+{
+   const auto begin = std::chrono::steady_clock::now();
+   f();
+   const auto end = std::chrono::steady_clock::now();
+   return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+int main(int argc, char** argv)
+{
+   std::vector<std::size_t> sizes;
+   for(int i=1; i<argc; ++i) { sizes.push_back(std::stoull(argv[i])); }
+   if(sizes.empty()) { sizes = {1000000, 10000000}; }
+
+   for(const std::size_t N : sizes) {
+      std::mt19937_64 gen(N);
+      std::uniform_int_distribution<std::size_t> dist(0, N-1);
+      std::vector<std::array<std::size_t,2>> pairs(N);
+      for(auto& p : pairs) { p = {dist(gen), dist(gen)}; }
+      std::cout << "elements = " << N << "\n";
+
+      std::size_t count = 0;
+      const double sequential_time = time_ms([&]() {
+            union_find uf(N);
+            for(const auto& p : pairs) { uf.merge(p[0], p[1]); }
+            count = uf.get_contiguous_ids().size() + uf.count();
+            });
+      std::cout << "  sequential union find: " << sequential_time << " ms\n";
+
+      std::size_t concurrent_count = 0;
+      const double concurrent_time = time_ms([&]() {
+            concurrent_union_find uf(N);
+#pragma omp parallel for
+            for(std::size_t k=0; k<pairs.size(); ++k) { uf.merge(pairs[k][0], pairs[k][1]); }
+            concurrent_count = uf.get_contiguous_ids().size() + uf.count();
+            });
+      std::cout << "  concurrent union find: " << concurrent_time << " ms\n";
+      if(count != concurrent_count) { std::cout << "  number of components differs\n"; return 1; }
+   }
+}
@@ -3,22 +3,89 @@
 
 #include "tree_decomposition.hxx"
 #include "FW-MAP.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 namespace LP_MP {
 
+// primal labelings of a tree, encoded by the nonzero entries of their subgradient as bitset over the Lagrangean variables of the tree.
+// The bitset is stored in the labeling buffer FWMAP holds for every labeling in its working set, hence labelings stay valid exactly as long as FWMAP keeps them.
+// The encoding is canonical, identical labelings returned by repeated oracle calls are stored identically.
+class labeling_bitset {
+public:
+  labeling_bitset(const INDEX no_Lagrangean_vars)
+    : no_Lagrangean_vars_(no_Lagrangean_vars),
+    words_((no_Lagrangean_vars + 63)/64)
+  {}
+
+  INDEX size_in_bytes() const { return words_.size()*sizeof(std::uint64_t); }
+
+  // indices are positions of ones in subgradient. Writes size_in_bytes() bytes to y
+  void write(const std::vector<INDEX>& indices, void* y)
+  {
+    std::fill(words_.begin(), words_.end(), 0);
+    for(const INDEX i : indices) {
+      assert(i < no_Lagrangean_vars_);
+      words_[i/64] |= std::uint64_t(1) << (i%64);
+    }
+    std::memcpy(y, words_.data(), size_in_bytes());
+  }
+
+  void copy(const void* y, double* w) const
+  {
+    std::fill(w, w + no_Lagrangean_vars_, 0.0);
+    for_each_index(y, [w](const INDEX i) { w[i] = 1.0; });
+  }
+
+  double dot_product(const void* y, const double* w) const
+  {
+    double v = 0.0;
+    for_each_index(y, [&v,w](const INDEX i) { v += w[i]; });
+    return v;
+  }
+
+private:
+  template<typename FUNC>
+  void for_each_index(const void* y, FUNC f) const
+  {
+    const char* bytes = static_cast<const char*>(y);
+    for(INDEX k=0; k<words_.size(); ++k) {
+      std::uint64_t word;
+      std::memcpy(&word, bytes + k*sizeof(std::uint64_t), sizeof(std::uint64_t)); // FWMAP does not align labeling buffers
+      for(; word != 0; word &= word - 1) {
+        f(64*k + __builtin_ctzll(word));
+      }
+    }
+  }
+
+  const INDEX no_Lagrangean_vars_;
+  std::vector<std::uint64_t> words_; // bitset of the labeling currently written
+};
+
 template<typename FMC_TYPE>
 class LP_tree_FWMAP : public LP_with_trees<FMC_TYPE, Lagrangean_factor_FWMAP, LP_tree_FWMAP<FMC_TYPE> > {
 public:
     using FMC = FMC_TYPE;
+   using tree_type = LP_tree_Lagrangean<FMC, Lagrangean_factor_FWMAP>;
+   // term data passed to FWMAP
+   struct term {
+      term(tree_type& _t) : t(&_t), labelings(_t.mapping().size()) {}
+      tree_type* t;
+      labeling_bitset labelings;
+      std::vector<INDEX> indices, scratch;
+   };
+
    // for the Frank Wolfe implementation
    // to do: change the FWMAP implementation and make these methods virtual instead of static.
-   // _y is the primal labeling to be computed
+   // _y is the primal labeling to be computed. It holds the labeling as bitset, see labeling_bitset.
    // wi is the Lagrangean variables
    static double max_fn(double* wi, FWMAP::YPtr _y, FWMAP::TermData term_data)
    {
-     
-      LP_tree_Lagrangean<FMC, Lagrangean_factor_FWMAP>* t = (LP_tree_Lagrangean<FMC, Lagrangean_factor_FWMAP>*) term_data;
+      term* d = static_cast<term*>(term_data);
+      tree_type* t = d->t;
 
       // first add weights to problem
       // we only need to add Lagrange variables to Lagrangean_factors_ (others are not shared)
@@ -26,8 +93,12 @@ public:
 
       // compute optimal labeling
       t->solve();
-      // store primal solution in archive
-      t->save_primal(_y);
+      // store primal solution as nonzero entries of its subgradient
+      d->indices.clear();
+      for(auto& L : t->Lagrangean_factors_) {
+         L.local_subgradient_indices(d->scratch, d->indices);
+      }
+      d->labelings.write(d->indices, _y);
 
       // remove weights again
       t->add_weights(wi, -1.0);
@@ -35,35 +106,17 @@ public:
       return t->primal_cost();
    }
 
-   // copy values provided by subgradient from Lagrangean factors into ai
+   // copy values provided by subgradient of labeling into ai
    static void copy_fn(double* ai, FWMAP::YPtr _y, FWMAP::TermData term_data)
    {
-      LP_tree_Lagrangean<FMC, Lagrangean_factor_FWMAP>* t = (LP_tree_Lagrangean<FMC, Lagrangean_factor_FWMAP>*) term_data;
-
-      // possibly this is not needed anymore
-      std::fill(ai, ai+t->dual_size(), double(0.0));
-
-      // read in primal solution from which to compute subgradient
-      t->read_in_primal(_y);
-
-      for(auto L : t->Lagrangean_factors_) {
-         L.copy_fn(ai);
-      }
+      term* d = static_cast<term*>(term_data);
+      d->labelings.copy(_y, ai);
    }
 
    static double dot_product_fn(double* wi, FWMAP::YPtr _y, FWMAP::TermData term_data)
    {
-      LP_tree_Lagrangean<FMC, Lagrangean_factor_FWMAP>* t = (LP_tree_Lagrangean<FMC, Lagrangean_factor_FWMAP>*) term_data;
-
-      // read in primal solution
-      t->read_in_primal(_y);
-
-      double v = 0.0;
-      for(auto L : t->Lagrangean_factors_) {
-         v += L.dot_product_fn(wi);
-      }
-
-      return v;
+      term* d = static_cast<term*>(term_data);
+      return d->labelings.dot_product(_y, wi);
    }
 
    void Begin()
@@ -76,11 +129,13 @@ public:
    {
       auto* bundle_solver = new FWMAP(this->no_Lagrangean_vars(), this->trees_.size(), LP_tree_FWMAP::max_fn, LP_tree_FWMAP::copy_fn, LP_tree_FWMAP::dot_product_fn);//int d, int n, MaxFn max_fn, CopyFn copy_fn, DotProductFn dot_product_fn);
 
+      terms_.clear();
+      terms_.reserve(this->trees_.size());
       for(std::size_t i=0; i<this->trees_.size(); ++i) {
          auto& t = this->trees_[i];
-         const auto primal_size_in_bytes = t.primal_size_in_bytes();
+         terms_.emplace_back(t);
 
-         bundle_solver->SetTerm(i, &t, t.mapping().size(), &t.mapping()[0], t.primal_size_in_bytes()); // although mapping is of length di + 1 (the last entry being di itself, its length must be given as di!
+         bundle_solver->SetTerm(i, &terms_.back(), t.mapping().size(), &t.mapping()[0], terms_.back().labelings.size_in_bytes()); // although mapping is of length di + 1 (the last entry being di itself, its length must be given as di!
       }
 
       //svm->options.gap_threshold = 0.0001;
@@ -93,6 +148,19 @@ public:
       return bundle_solver;
    }
 
+   // trees are evaluated at the multipliers added to them plus the current point lambda of FWMAP
+   std::vector<REAL> current_multipliers() const
+   {
+      std::vector<REAL> w = this->multipliers();
+      if(bundle_solver != nullptr) {
+         const double* lambda = bundle_solver->GetLambda();
+         for(std::size_t i=0; i<w.size(); ++i) {
+            w[i] += lambda[i];
+         }
+      }
+      return w;
+   }
+
    REAL decomposition_lower_bound() const
    {
      const auto lb2 = LP_with_trees<FMC_TYPE, Lagrangean_factor_FWMAP, LP_tree_FWMAP<FMC_TYPE> >::decomposition_lower_bound();
@@ -134,6 +202,7 @@ public:
 
 private:
   FWMAP* bundle_solver;
+  std::vector<term> terms_;
   REAL lb_;
   TCLAP::ValueArg<double> proximal_weight_arg_; 
 };
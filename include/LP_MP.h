@@ -37,10 +37,20 @@ namespace LP_MP {
 // forward declaration
 class MessageIterator;
 
-using weight_array = two_dim_variable_array<REAL>;
-using weight_slice = two_dim_variable_array<REAL>::ArrayAccessObject;
-using receive_array = two_dim_variable_array<unsigned char>;
-using receive_slice = two_dim_variable_array<unsigned char>::ArrayAccessObject;
+// weights and receive masks hold one entry per message and factor. They use 32 bit offsets unless the model has more than 2^32-1 messages.
+using weight_array = adaptive_two_dim_variable_array<REAL>;
+using weight_slice = array_slice<REAL>;
+using receive_array = adaptive_two_dim_variable_array<unsigned char>;
+using receive_slice = array_slice<unsigned char>;
+
+// call f with iterators over the rows of omega and receive_mask, resolved to the offset types actually used
+template<typename F>
+void visit_weights(weight_array& omega, receive_array& receive_mask, F&& f)
+{
+   omega.visit([&](auto& o) {
+      receive_mask.visit([&](auto& r) { f(o.begin(), r.begin()); });
+   });
+}
 
 // pure virtual base class for factor container used by LP class
 class FactorTypeAdapter
@@ -49,6 +59,7 @@ public:
    virtual ~FactorTypeAdapter() {}
    virtual FactorTypeAdapter* clone() const = 0;
    virtual void update_factor_uniform(const REAL leave_weight) = 0;
+   virtual void update_factor_primal_uniform(const REAL leave_weight, const INDEX iteration) = 0;
    virtual void UpdateFactor(const weight_slice omega, const receive_slice receive_mask) = 0;
    virtual void update_factor_adaptive(const weight_slice omega, const receive_slice receive_mask) = 0;
    virtual void update_factor_residual(const weight_slice omega, const receive_slice receive_mask) = 0;
@@ -76,6 +87,8 @@ public:
    // for writing primal solution into subgradient
    // return value is size of subgradient
    virtual INDEX subgradient(double* w, const REAL sign) = 0;
+   // indices at which subgradient writes sign
+   virtual void sparse_subgradient(std::vector<INDEX>& indices) = 0;
    virtual REAL dot_product(double* w) = 0;
 
    // for reading reparametrization/labeling out of factor
@@ -89,6 +102,8 @@ public:
    virtual void serialize_primal(allocate_archive&) = 0;
    // for adding weights in Frank Wolfe algorithm
    virtual void serialize_dual(addition_archive&) = 0;
+   // all dual_size() dual variables if they are stored as one contiguous array, nullptr otherwise
+   virtual REAL* dual_span() = 0;
 
    virtual void divide(const REAL val) = 0; // divide potential by value
    virtual void add(FactorTypeAdapter*) = 0; // add potential values of other factor
@@ -239,7 +254,7 @@ public:
    FACTOR_CONTAINER_TYPE* add_factor(ARGS... args)
    {
        auto* f = new FACTOR_CONTAINER_TYPE(args...);
-       set_flags_dirty();
+       set_flags_added(f);
        assert(factor_address_to_index_.size() == f_.size());
        f_.push_back(f);
 
@@ -254,6 +269,15 @@ public:
 
    INDEX GetNumberOfFactors() const { return f_.size(); }
    FactorTypeAdapter* GetFactor(const INDEX i) const { return f_[i]; }
+   INDEX get_factor_index(FactorTypeAdapter* f) const
+   {
+      auto it = factor_address_to_index_.find(f);
+      assert(it != factor_address_to_index_.end());
+      return it->second;
+   }
+   // level sets of forward/backward ordering relations, factors within one level are not ordered with respect to each other
+   const two_dim_variable_array<INDEX>& forward_wavefronts() { compute_wavefronts(); return f_forward_wavefronts_; }
+   const two_dim_variable_array<INDEX>& backward_wavefronts() { compute_wavefronts(); return f_backward_wavefronts_; }
 
    template<typename MESSAGE_CONTAINER_TYPE>
    static constexpr std::size_t message_tuple_index()
@@ -266,7 +290,7 @@ public:
    template<typename MESSAGE_CONTAINER_TYPE, typename LEFT_FACTOR, typename RIGHT_FACTOR, typename... ARGS>
    MESSAGE_CONTAINER_TYPE* add_message(LEFT_FACTOR* l, RIGHT_FACTOR* r, ARGS... args)
    {
-       set_flags_dirty();
+       set_flags_added(l, r);
 
        auto* m_l = l->template add_message<MESSAGE_CONTAINER_TYPE,Chirality::left>(r,args...);
        auto* m_r = r->template add_message<MESSAGE_CONTAINER_TYPE,Chirality::right>(l,args...);
@@ -287,6 +311,33 @@ public:
    message_trait GetMessage(const INDEX i) const { return m_[i]; }
    INDEX GetNumberOfMessages() const { return m_.size(); }
 
+   // call func on every factor resp. message with its concrete container type
+   template<typename FUNC>
+   void for_each_factor(FUNC func) const
+   {
+      for_each_tuple(factors_, [&func](auto& v) { for(auto* f : v) { func(f); } });
+   }
+   template<typename FUNC>
+   void for_each_message(FUNC func) const
+   {
+      for_each_tuple(messages_, [&func](auto& v) { for(auto* m : v) { func(m); } });
+   }
+   // call func on the vector of all factors resp. messages of each concrete container type
+   template<typename FUNC>
+   void for_each_factor_type(FUNC func) const
+   {
+      for_each_tuple(factors_, func);
+   }
+   template<typename FUNC>
+   void for_each_message_type(FUNC func) const
+   {
+      for_each_tuple(messages_, func);
+   }
+
+   // add clones of all factors of o together with copies of its messages, factor relations and constant to this empty LP.
+   // Factors keep their position, hence duals and primals serialized from o can be loaded into the copy.
+   void copy_model(const LP& o);
+
    void AddFactorRelation(FactorTypeAdapter* f1, FactorTypeAdapter* f2); // indicate that factor f1 comes before factor f2
    void ForwardPassFactorRelation(FactorTypeAdapter* f1, FactorTypeAdapter* f2);
    void BackwardPassFactorRelation(FactorTypeAdapter* f1, FactorTypeAdapter* f2);
@@ -321,11 +372,17 @@ public:
          const std::vector<std::pair<FactorTypeAdapter*, FactorTypeAdapter*>>& factor_rel,
          std::vector<FactorTypeAdapter*>& ordering,
          std::vector<FactorTypeAdapter*>& update_ordering,
-         std::vector<INDEX>& f_sorted
+         std::vector<INDEX>& f_sorted,
+         two_dim_variable_array<INDEX>& wavefronts
          );
 
    void SortFactors();
 
+   // insert factors added since last sorting into f_sorted. Returns false if new relations contradict the current order.
+   bool insert_into_ordering(const std::vector<std::pair<FactorTypeAdapter*, FactorTypeAdapter*>>& factor_rel, const std::size_t no_sorted_rel, std::vector<INDEX>& f_sorted) const;
+   void set_ordering(const std::vector<INDEX>& f_sorted, std::vector<FactorTypeAdapter*>& ordering, std::vector<FactorTypeAdapter*>& update_ordering) const;
+   void compute_wavefronts();
+
    //void ComputeWeights(const LPReparametrizationMode m);
    void set_reparametrization(const LPReparametrizationMode r) { repamMode_ = r; }
 
@@ -335,6 +392,12 @@ public:
    template<typename FACTOR_ITERATOR>
    void ComputeAnisotropicWeights(FACTOR_ITERATOR factorIt, FACTOR_ITERATOR factorItEnd, weight_array& omega, receive_array& receive_mask); 
 
+   // recompute anisotropic weights only for factors changed since last computation and their neighbours
+   void UpdateAnisotropicWeights();
+   void UpdateAnisotropicWeights(const std::vector<FactorTypeAdapter*>& ordering, const std::vector<INDEX>& f_sorted, const std::vector<bool>& had_weights, const std::unordered_set<FactorTypeAdapter*>& affected, weight_array& omega, receive_array& receive_mask);
+   template<typename POSITION_OP, typename OMEGA, typename RECEIVE_MASK>
+   void compute_anisotropic_weights(FactorTypeAdapter* f, POSITION_OP position, OMEGA omega, RECEIVE_MASK receive_mask);
+
    template<typename FACTOR_ITERATOR>
    std::unordered_map<FactorTypeAdapter*,std::size_t> get_factor_indices(FACTOR_ITERATOR f_begin, FACTOR_ITERATOR f_end);
 
@@ -352,9 +415,9 @@ public:
 
    void ComputeDampedUniformWeights();
    template<typename FACTOR_ITERATOR>
-   void ComputeUniformWeights(FACTOR_ITERATOR factorIt, FACTOR_ITERATOR factorEndIt, two_dim_variable_array<REAL>& omega, const REAL leave_weight); // do zrobienia: rename to isotropic weights
+   void ComputeUniformWeights(FACTOR_ITERATOR factorIt, FACTOR_ITERATOR factorEndIt, weight_array& omega, const REAL leave_weight); // do zrobienia: rename to isotropic weights
 
-   void ComputeMixedWeights(const two_dim_variable_array<REAL>& omega_anisotropic, const two_dim_variable_array<REAL>& omega_damped_uniform, two_dim_variable_array<REAL>& omega); 
+   void ComputeMixedWeights(const weight_array& omega_anisotropic, const weight_array& omega_damped_uniform, weight_array& omega); 
    void ComputeMixedWeights();
 
    void compute_full_receive_mask();
@@ -374,6 +437,15 @@ public:
    void ComputeForwardPassAndPrimal(const INDEX iteration);
    void ComputeBackwardPassAndPrimal(const INDEX iteration);
 
+   // passes with uniform weights computed on the fly. Used for (damped) uniform reparametrization, for which weights are not stored.
+   template<typename FACTOR_ITERATOR>
+   void ComputeUniformPass(FACTOR_ITERATOR factor_begin, const FACTOR_ITERATOR factor_end, const REAL leave_weight);
+   template<typename FACTOR_ITERATOR>
+   void ComputeUniformPassAndPrimal(FACTOR_ITERATOR factor_begin, const FACTOR_ITERATOR factor_end, const REAL leave_weight, const INDEX iteration);
+   // pass with interleaved primal rounding that updates factors in random order. Uniform weights are used, since anisotropic weights depend on the factor order.
+   template<typename RANDOM_GENERATOR>
+   void ComputeRandomOrderPassAndPrimal(const INDEX iteration, RANDOM_GENERATOR& gen);
+
    // compute pass with interleaved primal rounding on subset of potentials only. This can be used for horizon tracking and discrete tomography.
    template<typename FACTOR_ITERATOR, Direction DIRECTION>
    void ComputePassAndPrimal(FACTOR_ITERATOR factor_begin, FACTOR_ITERATOR factor_end, const INDEX iteration);
@@ -400,6 +472,8 @@ public:
    LPReparametrizationMode GetRepamMode() const { return repamMode_; }
 
    void set_flags_dirty();
+   // only factors, messages or ordering relations were added. Orderings and anisotropic weights can be updated incrementally.
+   void set_flags_added(FactorTypeAdapter* f1 = nullptr, FactorTypeAdapter* f2 = nullptr);
 
    // return type for get_omega
    struct omega_storage {
@@ -417,48 +491,46 @@ public:
 #ifdef LP_MP_PARALLEL
       compute_synchronization();
 #endif 
-      if(repamMode_ != LPReparametrizationMode::Anisotropic) {
-          if(!full_receive_mask_valid_) {
-              compute_full_receive_mask();
-              full_receive_mask_valid_ = true;
+      auto& w = get_weight_set(repamMode_);
+      if(!w.valid) {
+        evict_least_recently_used_weights();
+        if(repamMode_ == LPReparametrizationMode::Anisotropic) {
+          if(w.stale) {
+            UpdateAnisotropicWeights();
+          } else {
+            ComputeAnisotropicWeights();
           }
-      }
-
-      if(repamMode_ == LPReparametrizationMode::Anisotropic) {
-        if(!omega_anisotropic_valid_) {
-          ComputeAnisotropicWeights();
-          omega_anisotropic_valid_ = true;
-        }
-        return omega_storage{omegaForwardAnisotropic_, omegaBackwardAnisotropic_, anisotropic_receive_mask_forward_, anisotropic_receive_mask_backward_};
-      } else if(repamMode_ == LPReparametrizationMode::Anisotropic2) {
-        if(!omega_anisotropic2_valid_) {
+        } else if(repamMode_ == LPReparametrizationMode::Anisotropic2) {
           ComputeAnisotropicWeights2();
-          omega_anisotropic2_valid_ = true;
-        }
-        return omega_storage{omegaForwardAnisotropic2_, omegaBackwardAnisotropic2_, receive_mask_anisotropic2_forward_, receive_mask_anisotropic2_backward_};
-      } else if(repamMode_ == LPReparametrizationMode::Uniform) {
-        if(!omega_isotropic_valid_) {
+        } else if(repamMode_ == LPReparametrizationMode::Uniform) {
           ComputeUniformWeights();
-          omega_isotropic_valid_ = true;
-        }
-        return omega_storage{omegaForwardIsotropic_, omegaBackwardIsotropic_, full_receive_mask_forward_, full_receive_mask_backward_};
-      } else if(repamMode_ == LPReparametrizationMode::DampedUniform) {
-        if(!omega_isotropic_damped_valid_) {
+        } else if(repamMode_ == LPReparametrizationMode::DampedUniform) {
           ComputeDampedUniformWeights();
-          omega_isotropic_damped_valid_ = true;
-        }
-        return omega_storage{omegaForwardIsotropicDamped_, omegaBackwardIsotropicDamped_, full_receive_mask_forward_, full_receive_mask_backward_};
-      } else if(repamMode_ == LPReparametrizationMode::Mixed) {
-        if(!omega_mixed_valid_) {
+        } else if(repamMode_ == LPReparametrizationMode::Mixed) {
           ComputeMixedWeights();
-          omega_mixed_valid_ = true;
+        } else {
+          throw std::runtime_error("no reparametrization mode set");
         }
-        return omega_storage{omegaForwardMixed_, omegaBackwardMixed_, full_receive_mask_forward_, full_receive_mask_backward_};
+        w.valid = true;
+      }
+      w.last_use = ++weight_set_use_counter_;
+
+      if(repamMode_ == LPReparametrizationMode::Anisotropic || repamMode_ == LPReparametrizationMode::Anisotropic2) {
+        return omega_storage{w.forward, w.backward, w.receive_mask_forward, w.receive_mask_backward};
       } else {
-        throw std::runtime_error("no reparametrization mode set");
+        if(!full_receive_mask_valid_) {
+          compute_full_receive_mask();
+          full_receive_mask_valid_ = true;
+        }
+        return omega_storage{w.forward, w.backward, full_receive_mask_forward_, full_receive_mask_backward_};
       }
    }
 
+   // free weights of given reparametrization mode. They are recomputed when needed again.
+   void evict_weights(const LPReparametrizationMode m);
+   void evict_weights();
+   std::size_t weights_size_in_bytes() const;
+
    void add_to_constant(const REAL x) { constant_ += x; }
 
    // methods for staged optimization
@@ -497,21 +569,57 @@ protected:
 
 
    bool ordering_valid_ = false;
+   // orderings were valid before only factors, messages or relations have been added, new factors can be inserted into them
+   bool incremental_ordering_ = false;
+   std::size_t sorted_no_factors_ = 0, sorted_no_forward_rel_ = 0, sorted_no_backward_rel_ = 0; // sizes at last sorting
+   bool wavefronts_valid_ = false;
+   std::vector<FactorTypeAdapter*> changed_factors_; // added factors and endpoints of added messages since anisotropic weights were computed
    std::vector<FactorTypeAdapter*> forwardOrdering_, backwardOrdering_; // separate forward and backward ordering are not needed: Just store factorOrdering_ and generate forward order by begin() and backward order by rbegin().
    std::vector<FactorTypeAdapter*> forwardUpdateOrdering_, backwardUpdateOrdering_; // like forwardOrdering_, but includes only those factors where UpdateFactor actually does something
 
-   bool omega_anisotropic_valid_ = false;
-   two_dim_variable_array<REAL> omegaForwardAnisotropic_, omegaBackwardAnisotropic_;
-   receive_array anisotropic_receive_mask_forward_, anisotropic_receive_mask_backward_;
-   bool omega_anisotropic2_valid_ = false;
-   two_dim_variable_array<REAL> omegaForwardAnisotropic2_, omegaBackwardAnisotropic2_;
-   receive_array receive_mask_anisotropic2_forward_, receive_mask_anisotropic2_backward_;
-   bool omega_isotropic_valid_ = false;
-   two_dim_variable_array<REAL> omegaForwardIsotropic_, omegaBackwardIsotropic_;
-   bool omega_isotropic_damped_valid_ = false;
-   two_dim_variable_array<REAL> omegaForwardIsotropicDamped_, omegaBackwardIsotropicDamped_;
-   bool omega_mixed_valid_ = false;
-   two_dim_variable_array<REAL> omegaForwardMixed_, omegaBackwardMixed_;
+   // weights for forward and backward pass of one reparametrization mode.
+   // At most max_weight_sets_arg_ sets are held at the same time, the least recently used one is evicted first.
+   struct weight_set {
+      bool valid = false;
+      bool stale = false; // computed for fewer factors or messages, update incrementally for changed_factors_
+      std::vector<bool> had_weights; // FactorUpdated() of each factor when computed, only those have rows in forward and backward
+      std::size_t last_use = 0;
+      weight_array forward, backward;
+      receive_array receive_mask_forward, receive_mask_backward; // only for anisotropic modes, others use the full receive mask
+   };
+   std::array<weight_set, 5> weight_sets_; // indexed by LPReparametrizationMode
+   std::size_t weight_set_use_counter_ = 0;
+
+   std::vector<bool> factors_updated() const
+   {
+      std::vector<bool> updated(f_.size());
+      for(std::size_t i=0; i<f_.size(); ++i) { updated[i] = f_[i]->FactorUpdated(); }
+      return updated;
+   }
+
+   weight_set& get_weight_set(const LPReparametrizationMode m)
+   {
+      assert(m != LPReparametrizationMode::Undefined);
+      assert(static_cast<std::size_t>(m) < weight_sets_.size());
+      return weight_sets_[static_cast<std::size_t>(m)];
+   }
+   void evict_least_recently_used_weights();
+
+   // (damped) uniform weights only depend on the number of messages a factor sends. They are not stored when message passing can compute them on the fly.
+   bool uniform_weights_implicit() const
+   {
+#ifdef LP_MP_PARALLEL
+      return false; // synchronized updates read explicit weights
+#else
+      return (repamMode_ == LPReparametrizationMode::Uniform || repamMode_ == LPReparametrizationMode::DampedUniform)
+         && (reparametrization_type_ == reparametrization_type::shared || reparametrization_type_ == reparametrization_type::partition || reparametrization_type_ == reparametrization_type::overlapping_partition);
+#endif
+   }
+   REAL uniform_leave_weight() const
+   {
+      assert(repamMode_ == LPReparametrizationMode::Uniform || repamMode_ == LPReparametrizationMode::DampedUniform);
+      return repamMode_ == LPReparametrizationMode::DampedUniform ? 1.0 : 0.0;
+   }
 
    bool full_receive_mask_valid_ = false;
    receive_array full_receive_mask_forward_, full_receive_mask_backward_;
@@ -521,11 +629,13 @@ protected:
    
    std::unordered_map<FactorTypeAdapter*,INDEX> factor_address_to_index_;
    std::vector<INDEX> f_forward_sorted_, f_backward_sorted_; // sorted indices in factor vector f_ 
+   two_dim_variable_array<INDEX> f_forward_wavefronts_, f_backward_wavefronts_; // indices in f_ that can be updated concurrently, level by level
 
    LPReparametrizationMode repamMode_ = LPReparametrizationMode::Undefined;
 
    TCLAP::ValueArg<std::string> reparametrization_type_arg_; // shared|residual|partition|overlapping_partition|adaptive
    TCLAP::ValueArg<INDEX> inner_iteration_number_arg_;
+   TCLAP::ValueArg<INDEX> max_weight_sets_arg_;
    enum class reparametrization_type {shared,residual,partition,overlapping_partition,adaptive};
    reparametrization_type reparametrization_type_;
 #ifdef LP_MP_PARALLEL
@@ -588,6 +698,7 @@ template<typename FMC>
 LP<FMC>::LP(TCLAP::CmdLine& cmd)
 : reparametrization_type_arg_("","reparametrizationType","message sending type: ", false, "shared", "{shared|residual|partition|overlapping_partition|adaptive}", cmd)
 , inner_iteration_number_arg_("","innerIteration","number of iterations in inner loop in partition reparamtrization, default = 5",false,5,&positiveIntegerConstraint,cmd) 
+, max_weight_sets_arg_("","maxWeightSets","maximum number of reparametrization weight sets held in memory, 0 = no limit, default = 2",false,2,"non-negative integer",cmd)
 #ifdef LP_MP_PARALLEL
 , num_lp_threads_arg_("","numLpThreads","number of threads for message passing, default = 1",false,1,&positiveIntegerConstraint,cmd)
 #endif
@@ -604,6 +715,7 @@ template<typename FMC>
 LP<FMC>::LP(LP& o) // no const because of o.num_lp_threads_arg_.getValue() not being const!
   : reparametrization_type_arg_("","reparametrizationType","message sending type: ", false, o.reparametrization_type_arg_.getValue(), "{shared|residual|partition|overlapping_partition|adaptive}" )
 , inner_iteration_number_arg_("","innerIteration","number of iterations in inner loop in partition reparamtrization, default = 5",false,o.inner_iteration_number_arg_.getValue(),&positiveIntegerConstraint) 
+, max_weight_sets_arg_("","maxWeightSets","maximum number of reparametrization weight sets held in memory, 0 = no limit, default = 2",false,o.max_weight_sets_arg_.getValue(),"non-negative integer")
 #ifdef LP_MP_PARALLEL
     , num_lp_threads_arg_("","numLpThreads","number of threads for message passing, default = 1",false,o.num_lp_threads_arg_.getValue(),&positiveIntegerConstraint)
 #endif
@@ -628,22 +740,15 @@ LP<FMC>::LP(LP& o) // no const because of o.num_lp_threads_arg_.getValue() not b
   }
 
   ordering_valid_ = o.ordering_valid_;
-  omega_anisotropic_valid_ = o.omega_anisotropic_valid_ ;
-  omega_anisotropic2_valid_ = o.omega_anisotropic2_valid_;
-  omega_isotropic_valid_ = o.omega_isotropic_valid_ ;
-  omega_isotropic_damped_valid_ = o.omega_isotropic_damped_valid_ ;
-  omega_mixed_valid_ = o.omega_mixed_valid_;
-
-  omegaForwardAnisotropic_ = o.omegaForwardAnisotropic_; 
-  omegaBackwardAnisotropic_ = o.omegaBackwardAnisotropic_;
-  omegaForwardAnisotropic2_ = o.omegaForwardAnisotropic_; 
-  omegaBackwardAnisotropic2_ = o.omegaBackwardAnisotropic_;
-  omegaForwardIsotropic_ = o.omegaForwardIsotropic_; 
-  omegaBackwardIsotropic_ = o.omegaBackwardIsotropic_;
-  omegaForwardIsotropicDamped_ = o.omegaForwardIsotropicDamped_; 
-  omegaBackwardIsotropicDamped_ = o.omegaBackwardIsotropicDamped_;
-  omegaForwardMixed_ = o.omegaForwardMixed_; 
-  omegaBackwardMixed_ = o.omegaBackwardMixed_;
+  incremental_ordering_ = o.incremental_ordering_;
+  sorted_no_factors_ = o.sorted_no_factors_;
+  sorted_no_forward_rel_ = o.sorted_no_forward_rel_;
+  sorted_no_backward_rel_ = o.sorted_no_backward_rel_;
+  for(auto* f : o.changed_factors_) {
+    changed_factors_.push_back( factor_map[f] );
+  }
+  weight_sets_ = o.weight_sets_;
+  weight_set_use_counter_ = o.weight_set_use_counter_;
 
   forwardOrdering_.reserve(o.forwardOrdering_.size());
   for(auto* f : o.forwardOrdering_) {
@@ -678,10 +783,65 @@ LP<FMC>::LP(LP& o) // no const because of o.num_lp_threads_arg_.getValue() not b
   constant_ = o.constant_;
 }
 
+template<typename FMC>
+void LP<FMC>::copy_model(const LP& o)
+{
+  assert(f_.empty() && m_.empty());
+  std::unordered_map<FactorTypeAdapter*, FactorTypeAdapter*> factor_map; // translate addresses from o's factors to this' factors
+  factor_map.reserve(o.f_.size());
+  for_each_tuple(o.factors_, [&](auto& v) {
+    using factor_container_type = typename std::remove_pointer<typename std::decay<decltype(v)>::type::value_type>::type;
+    auto& clones = std::get<factor_tuple_index<factor_container_type>()>(factors_);
+    clones.reserve(v.size());
+    for(auto* f : v) {
+      auto* c = static_cast<factor_container_type*>(f->clone());
+      clones.push_back(c);
+      factor_map.insert(std::make_pair(f, c));
+    }
+  });
+
+  f_.reserve(o.f_.size());
+  factor_address_to_index_.reserve(o.f_.size());
+  for(auto* f : o.f_) {
+    auto* c = factor_map[f];
+    factor_address_to_index_.insert(std::make_pair(c, f_.size()));
+    f_.push_back(c);
+  }
+
+  // messages are added per type, hence m_ may be ordered differently than in o
+  m_.reserve(o.m_.size());
+  for_each_tuple(o.messages_, [&](auto& v) {
+    using message_container_type = typename std::remove_pointer<typename std::decay<decltype(v)>::type::value_type>::type;
+    using left_factor_type = typename message_container_type::LeftFactorContainer;
+    using right_factor_type = typename message_container_type::RightFactorContainer;
+    for(auto* m : v) {
+      auto* l = static_cast<left_factor_type*>(factor_map[m->GetLeftFactor()]);
+      auto* r = static_cast<right_factor_type*>(factor_map[m->GetRightFactor()]);
+      this->template add_message<message_container_type>(l, r, m->GetMessageOp());
+    }
+  });
+
+  forward_pass_factor_rel_.reserve(o.forward_pass_factor_rel_.size());
+  for(auto f : o.forward_pass_factor_rel_) {
+    forward_pass_factor_rel_.push_back( std::make_pair(factor_map[f.first], factor_map[f.second]) );
+  }
+  backward_pass_factor_rel_.reserve(o.backward_pass_factor_rel_.size());
+  for(auto f : o.backward_pass_factor_rel_) {
+    backward_pass_factor_rel_.push_back( std::make_pair(factor_map[f.first], factor_map[f.second]) );
+  }
+  for(auto p : o.partition_graph) {
+    partition_graph.push_back({factor_map[p[0]], factor_map[p[1]]});
+  }
+
+  constant_ = o.constant_;
+  reparametrization_type_ = o.reparametrization_type_;
+  set_flags_dirty();
+}
+
 template<typename FMC>
 void LP<FMC>::ForwardPassFactorRelation(FactorTypeAdapter* f1, FactorTypeAdapter* f2) 
 { 
-  set_flags_dirty();
+  set_flags_added();
   assert(f1!=f2);
   forward_pass_factor_rel_.push_back({f1,f2}); 
 }
@@ -689,7 +849,7 @@ void LP<FMC>::ForwardPassFactorRelation(FactorTypeAdapter* f1, FactorTypeAdapter
 template<typename FMC>
 void LP<FMC>::BackwardPassFactorRelation(FactorTypeAdapter* f1, FactorTypeAdapter* f2) 
 { 
-  set_flags_dirty(); 
+  set_flags_added();
   assert(f1!=f2); 
   backward_pass_factor_rel_.push_back({f1,f2}); 
 }
@@ -732,7 +892,8 @@ void LP<FMC>::SortFactors(
     const std::vector<std::pair<FactorTypeAdapter*, FactorTypeAdapter*>>& factor_rel,
     std::vector<FactorTypeAdapter*>& ordering,
     std::vector<FactorTypeAdapter*>& update_ordering,
-    std::vector<INDEX>& f_sorted
+    std::vector<INDEX>& f_sorted,
+    two_dim_variable_array<INDEX>& wavefronts
     )
 {
   // assume that factorRel_ describe a DAG. Compute topological sorting
@@ -752,33 +913,98 @@ void LP<FMC>::SortFactors(
   }
 
   f_sorted = g.topologicalSort();
-  //std::vector<INDEX> sortedIndices = g.topologicalSort();
+  wavefronts = g.wavefronts();
   assert(f_sorted.size() == f_.size());
 
-  std::vector<FactorTypeAdapter*> fSorted;
-  fSorted.reserve(f_.size());
+  set_ordering(f_sorted, ordering, update_ordering);
+}
+
+template<typename FMC>
+void LP<FMC>::set_ordering(const std::vector<INDEX>& f_sorted, std::vector<FactorTypeAdapter*>& ordering, std::vector<FactorTypeAdapter*>& update_ordering) const
+{
+  ordering.clear();
+  ordering.reserve(f_.size());
   for(INDEX i=0; i<f_sorted.size(); i++) {
-      fSorted.push_back( f_[ f_sorted[i] ] );
+      ordering.push_back( f_[ f_sorted[i] ] );
   }
-  assert(HasUniqueValues(fSorted));
-  ordering  = fSorted;
+  assert(HasUniqueValues(ordering));
   update_ordering.clear();
   for(auto f : ordering) {
     if(f->FactorUpdated()) {
       update_ordering.push_back(f);
     }
   }
-  // check whether sorting was successful
-  /*
-     std::map<FactorTypeAdapter*, INDEX> factorToIndexSorted;
-     std::map<INDEX, FactorTypeAdapter*> indexToFactorSorted;
-     BuildIndexMaps(ordering.begin(), ordering.end(), factorToIndexSorted, indexToFactorSorted);
-     for(auto rel : factor_rel) {
-     const INDEX index_left = factorToIndexSorted[ std::get<0>(rel) ];
-     const INDEX index_right = factorToIndexSorted[ std::get<1>(rel) ];
-     assert(index_left < index_right);
-     }
-   */
+}
+
+// Old factors keep their relative order. A new factor is placed directly after its last old predecessor, new factors among each other are sorted topologically.
+// This is valid if every new factor still comes before its old successors.
+template<typename FMC>
+bool LP<FMC>::insert_into_ordering(
+    const std::vector<std::pair<FactorTypeAdapter*, FactorTypeAdapter*>>& factor_rel, const std::size_t no_sorted_rel,
+    std::vector<INDEX>& f_sorted) const
+{
+  const std::size_t no_old_factors = f_sorted.size();
+  assert(no_old_factors <= f_.size());
+  const std::size_t no_new_factors = f_.size() - no_old_factors;
+
+  std::vector<INDEX> position(no_old_factors);
+  for(INDEX p=0; p<no_old_factors; ++p) {
+    position[f_sorted[p]] = p;
+  }
+
+  // new factor i must lie after old factor at position lower[i]-1 and before old factor at position upper[i].
+  std::vector<INDEX> lower(no_new_factors, 0);
+  std::vector<INDEX> upper(no_new_factors, std::numeric_limits<INDEX>::max());
+  Topological_Sort::Graph g(no_new_factors);
+  std::vector<std::array<INDEX,2>> new_rel;
+  for(auto rel_it=factor_rel.begin() + no_sorted_rel; rel_it!=factor_rel.end(); ++rel_it) {
+    assert(factor_address_to_index_.count(rel_it->first) > 0 && factor_address_to_index_.count(rel_it->second) > 0);
+    const INDEX f1 = factor_address_to_index_.find(rel_it->first)->second;
+    const INDEX f2 = factor_address_to_index_.find(rel_it->second)->second;
+    if(f1 < no_old_factors && f2 < no_old_factors) {
+      if(position[f1] > position[f2]) { return false; }
+    } else if(f1 < no_old_factors) {
+      lower[f2 - no_old_factors] = std::max(lower[f2 - no_old_factors], position[f1] + 1);
+    } else if(f2 < no_old_factors) {
+      upper[f1 - no_old_factors] = std::min(upper[f1 - no_old_factors], position[f2]);
+    } else {
+      g.addEdge(f1 - no_old_factors, f2 - no_old_factors);
+      new_rel.push_back({f1 - no_old_factors, f2 - no_old_factors});
+    }
+  }
+
+  const auto new_sorted = g.topologicalSort();
+  std::vector<INDEX> new_position(no_new_factors);
+  for(INDEX p=0; p<no_new_factors; ++p) {
+    new_position[new_sorted[p]] = p;
+  }
+  // successors of a new factor must not be placed before it
+  std::sort(new_rel.begin(), new_rel.end(), [&](const auto& r1, const auto& r2) { return new_position[r1[0]] < new_position[r2[0]]; });
+  for(const auto& r : new_rel) {
+    lower[r[1]] = std::max(lower[r[1]], lower[r[0]]);
+  }
+  for(INDEX i=0; i<no_new_factors; ++i) {
+    if(lower[i] > upper[i]) { return false; }
+  }
+
+  std::vector<INDEX> insertion_order(new_sorted);
+  std::stable_sort(insertion_order.begin(), insertion_order.end(), [&](const INDEX i, const INDEX j) { return lower[i] < lower[j]; });
+
+  std::vector<INDEX> merged;
+  merged.reserve(f_.size());
+  auto new_it = insertion_order.begin();
+  for(INDEX p=0; p<no_old_factors; ++p) {
+    for(; new_it!=insertion_order.end() && lower[*new_it] <= p; ++new_it) {
+      merged.push_back(no_old_factors + *new_it);
+    }
+    merged.push_back(f_sorted[p]);
+  }
+  for(; new_it!=insertion_order.end(); ++new_it) {
+    merged.push_back(no_old_factors + *new_it);
+  }
+  assert(merged.size() == f_.size());
+  std::swap(f_sorted, merged);
+  return true;
 }
 
 template<typename FMC>
@@ -787,13 +1013,61 @@ void LP<FMC>::SortFactors()
   if(ordering_valid_) { return; }
   ordering_valid_ = true;
 
+  if(incremental_ordering_) {
+    incremental_ordering_ = false;
+    std::vector<INDEX> f_forward_sorted = f_forward_sorted_;
+    std::vector<INDEX> f_backward_sorted = f_backward_sorted_;
+    if(insert_into_ordering(forward_pass_factor_rel_, sorted_no_forward_rel_, f_forward_sorted) &&
+       insert_into_ordering(backward_pass_factor_rel_, sorted_no_backward_rel_, f_backward_sorted)) {
+      if(debug()) { std::cout << "insert " << f_.size() - sorted_no_factors_ << " factors into ordering\n"; }
+      f_forward_sorted_ = std::move(f_forward_sorted);
+      f_backward_sorted_ = std::move(f_backward_sorted);
+      set_ordering(f_forward_sorted_, forwardOrdering_, forwardUpdateOrdering_);
+      set_ordering(f_backward_sorted_, backwardOrdering_, backwardUpdateOrdering_);
+      wavefronts_valid_ = false;
+      sorted_no_factors_ = f_.size();
+      sorted_no_forward_rel_ = forward_pass_factor_rel_.size();
+      sorted_no_backward_rel_ = backward_pass_factor_rel_.size();
+      return;
+    }
+  }
+
+  // positions of old factors change, hence weights cannot be updated incrementally
+  if(get_weight_set(LPReparametrizationMode::Anisotropic).stale) {
+    evict_weights(LPReparametrizationMode::Anisotropic);
+  }
+  changed_factors_.clear();
+
 #pragma omp parallel sections
   {
 #pragma omp section
-    SortFactors(forward_pass_factor_rel_, forwardOrdering_, forwardUpdateOrdering_, f_forward_sorted_);
+    SortFactors(forward_pass_factor_rel_, forwardOrdering_, forwardUpdateOrdering_, f_forward_sorted_, f_forward_wavefronts_);
 #pragma omp section
-    SortFactors(backward_pass_factor_rel_, backwardOrdering_, backwardUpdateOrdering_, f_backward_sorted_);
+    SortFactors(backward_pass_factor_rel_, backwardOrdering_, backwardUpdateOrdering_, f_backward_sorted_, f_backward_wavefronts_);
   }
+  wavefronts_valid_ = true;
+  sorted_no_factors_ = f_.size();
+  sorted_no_forward_rel_ = forward_pass_factor_rel_.size();
+  sorted_no_backward_rel_ = backward_pass_factor_rel_.size();
+}
+
+template<typename FMC>
+void LP<FMC>::compute_wavefronts()
+{
+  SortFactors();
+  if(wavefronts_valid_) { return; }
+  wavefronts_valid_ = true;
+
+  auto wavefronts = [&](const auto& factor_rel, two_dim_variable_array<INDEX>& w) {
+    Topological_Sort::Graph g(f_.size());
+    for(const auto& rel : factor_rel) {
+      g.addEdge(factor_address_to_index_.find(rel.first)->second, factor_address_to_index_.find(rel.second)->second);
+    }
+    g.topologicalSort();
+    w = g.wavefronts();
+  };
+  wavefronts(forward_pass_factor_rel_, f_forward_wavefronts_);
+  wavefronts(backward_pass_factor_rel_, f_backward_wavefronts_);
 }
 
 
@@ -889,49 +1163,79 @@ inline void LP<FMC>::ComputePass(const INDEX iteration)
 template<typename FMC>
 void LP<FMC>::ComputeForwardPass()
 {
+  if(uniform_weights_implicit()) {
+    SortFactors();
+    ComputeUniformPass(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), uniform_leave_weight());
+    return;
+  }
   const auto omega = get_omega();
   assert(omega.forward.size() == omega.receive_mask_forward.size());
   assert(omega.backward.size() == omega.receive_mask_backward.size());
 #ifdef LP_MP_PARALLEL
-  ComputePassSynchronized(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), omega.forward.begin(), omega.forward.end(), synchronize_forward_.begin(), synchronize_forward_.end()); 
+  omega.forward.visit([&](auto& o) { ComputePassSynchronized(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), o.begin(), o.end(), synchronize_forward_.begin(), synchronize_forward_.end()); }); 
 #else
-  ComputePass(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), omega.forward.begin(), omega.receive_mask_forward.begin()); 
+  visit_weights(omega.forward, omega.receive_mask_forward, [&](auto omega_it, auto receive_mask_it) { ComputePass(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), omega_it, receive_mask_it); }); 
 #endif
 }
 
 template<typename FMC>
 void LP<FMC>::ComputeBackwardPass()
 {
+  if(uniform_weights_implicit()) {
+    SortFactors();
+    ComputeUniformPass(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), uniform_leave_weight());
+    return;
+  }
   const auto omega = get_omega();
 #ifdef LP_MP_PARALLEL
-  ComputePassSynchronized(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), omega.backward.begin(), omega.backward.end(), synchronize_backward_.begin(), synchronize_backward_.end()); 
+  omega.backward.visit([&](auto& o) { ComputePassSynchronized(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), o.begin(), o.end(), synchronize_backward_.begin(), synchronize_backward_.end()); }); 
 #else
-  ComputePass(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), omega.backward.begin(), omega.receive_mask_backward.begin());
+  visit_weights(omega.backward, omega.receive_mask_backward, [&](auto omega_it, auto receive_mask_it) { ComputePass(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), omega_it, receive_mask_it); });
 #endif
 }
 
 template<typename FMC>
 void LP<FMC>::ComputeForwardPassAndPrimal(const INDEX iteration)
 {
+  if(uniform_weights_implicit()) {
+    SortFactors();
+    ComputeUniformPassAndPrimal(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), uniform_leave_weight(), 2*iteration+1);
+    return;
+  }
   const auto omega = get_omega();
 #ifdef LP_MP_PARALLEL
-  ComputePassAndPrimalSynchronized(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), omega.forward.begin(), synchronize_forward_.begin(), 2*iteration+1); // timestamp must be > 0, otherwise in the first iteration primal does not get initialized
+  omega.forward.visit([&](auto& o) { ComputePassAndPrimalSynchronized(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), o.begin(), synchronize_forward_.begin(), 2*iteration+1); }); // timestamp must be > 0, otherwise in the first iteration primal does not get initialized
 #else
-  ComputePassAndPrimal(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), omega.forward.begin(), omega.receive_mask_forward.begin(), 2*iteration+1); // timestamp must be > 0, otherwise in the first iteration primal does not get initialized
+  visit_weights(omega.forward, omega.receive_mask_forward, [&](auto omega_it, auto receive_mask_it) { ComputePassAndPrimal(forwardUpdateOrdering_.begin(), forwardUpdateOrdering_.end(), omega_it, receive_mask_it, 2*iteration+1); }); // timestamp must be > 0, otherwise in the first iteration primal does not get initialized
 #endif
 }
 
 template<typename FMC>
 void LP<FMC>::ComputeBackwardPassAndPrimal(const INDEX iteration)
 {
+  if(uniform_weights_implicit()) {
+    SortFactors();
+    ComputeUniformPassAndPrimal(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), uniform_leave_weight(), 2*iteration + 2);
+    return;
+  }
   const auto omega = get_omega();
 #ifdef LP_MP_PARALLEL
-  ComputePassAndPrimalSynchronized(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), omega.backward.begin(), synchronize_backward_.begin(), 2*iteration + 2); 
+  omega.backward.visit([&](auto& o) { ComputePassAndPrimalSynchronized(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), o.begin(), synchronize_backward_.begin(), 2*iteration + 2); }); 
 #else
-  ComputePassAndPrimal(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), omega.backward.begin(), omega.receive_mask_backward.begin(), 2*iteration + 2); 
+  visit_weights(omega.backward, omega.receive_mask_backward, [&](auto omega_it, auto receive_mask_it) { ComputePassAndPrimal(backwardUpdateOrdering_.begin(), backwardUpdateOrdering_.end(), omega_it, receive_mask_it, 2*iteration + 2); }); 
 #endif
 }
 
+template<typename FMC>
+template<typename RANDOM_GENERATOR>
+void LP<FMC>::ComputeRandomOrderPassAndPrimal(const INDEX iteration, RANDOM_GENERATOR& gen)
+{
+  SortFactors();
+  std::vector<FactorTypeAdapter*> ordering(forwardUpdateOrdering_);
+  std::shuffle(ordering.begin(), ordering.end(), gen);
+  ComputeUniformPassAndPrimal(ordering.begin(), ordering.end(), 0.0, 2*iteration + 1);
+}
+
 template<typename FMC>
 void LP<FMC>::ComputePassAndPrimal(const INDEX iteration)
 {
@@ -1004,11 +1308,31 @@ void LP<FMC>::ComputePass(FACTOR_ITERATOR factorIt, const FACTOR_ITERATOR factor
     }
 }
 
+template<typename FMC>
+template<typename FACTOR_ITERATOR>
+void LP<FMC>::ComputeUniformPass(FACTOR_ITERATOR factor_begin, const FACTOR_ITERATOR factor_end, const REAL leave_weight)
+{
+    assert(leave_weight >= 0.0);
+    for(auto it=factor_begin; it!=factor_end; ++it) {
+        (*it)->update_factor_uniform(leave_weight);
+    }
+}
+
+template<typename FMC>
+template<typename FACTOR_ITERATOR>
+void LP<FMC>::ComputeUniformPassAndPrimal(FACTOR_ITERATOR factor_begin, const FACTOR_ITERATOR factor_end, const REAL leave_weight, const INDEX iteration)
+{
+    assert(leave_weight >= 0.0);
+    for(auto it=factor_begin; it!=factor_end; ++it) {
+        (*it)->update_factor_primal_uniform(leave_weight, iteration);
+    }
+}
+
 template<typename FMC>
 void LP<FMC>::omega_valid(const weight_array& omega) const
 {
     for(std::size_t i=0; i<omega.size(); ++i) {
-        assert(*std::min_element(omega[i].begin(), omega[i].end()) >= 0.0);
+        assert(omega[i].size() == 0 || *std::min_element(omega[i].begin(), omega[i].end()) >= 0.0);
         assert(std::accumulate(omega[i].begin(), omega[i].end(), 0.0) <= 1.0 + eps);
     }
 }
@@ -1016,50 +1340,249 @@ void LP<FMC>::omega_valid(const weight_array& omega) const
 template<typename FMC>
 inline void LP<FMC>::ComputeAnisotropicWeights()
 {
-  ComputeAnisotropicWeights(forwardOrdering_.begin(), forwardOrdering_.end(), omegaForwardAnisotropic_, anisotropic_receive_mask_forward_);
-  ComputeAnisotropicWeights(backwardOrdering_.begin(), backwardOrdering_.end(), omegaBackwardAnisotropic_, anisotropic_receive_mask_backward_);
+  auto& w = get_weight_set(LPReparametrizationMode::Anisotropic);
+  ComputeAnisotropicWeights(forwardOrdering_.begin(), forwardOrdering_.end(), w.forward, w.receive_mask_forward);
+  ComputeAnisotropicWeights(backwardOrdering_.begin(), backwardOrdering_.end(), w.backward, w.receive_mask_backward);
+  w.had_weights = factors_updated();
+  changed_factors_.clear();
+
+  omega_valid(w.forward);
+  omega_valid(w.backward);
+}
+
+template<typename FMC>
+inline void LP<FMC>::UpdateAnisotropicWeights()
+{
+  auto& w = get_weight_set(LPReparametrizationMode::Anisotropic);
+  assert(w.stale && !w.valid);
+
+  std::unordered_set<FactorTypeAdapter*> affected;
+  for(auto* f : changed_factors_) {
+    affected.insert(f);
+    for(auto* adjacent : f->get_adjacent_factors()) {
+      affected.insert(adjacent);
+    }
+  }
+  if(debug()) { std::cout << "update anisotropic weights of " << affected.size() << " factors\n"; }
+
+  UpdateAnisotropicWeights(forwardOrdering_, f_forward_sorted_, w.had_weights, affected, w.forward, w.receive_mask_forward);
+  UpdateAnisotropicWeights(backwardOrdering_, f_backward_sorted_, w.had_weights, affected, w.backward, w.receive_mask_backward);
+  w.stale = false;
+  w.had_weights = factors_updated();
+  changed_factors_.clear();
+
+  omega_valid(w.forward);
+  omega_valid(w.backward);
+
+#ifndef NDEBUG
+  weight_array omega_forward, omega_backward;
+  receive_array receive_mask_forward, receive_mask_backward;
+  ComputeAnisotropicWeights(forwardOrdering_.begin(), forwardOrdering_.end(), omega_forward, receive_mask_forward);
+  ComputeAnisotropicWeights(backwardOrdering_.begin(), backwardOrdering_.end(), omega_backward, receive_mask_backward);
+  auto equal = [](const auto& a, const auto& b) {
+    if(a.size() != b.size()) { return false; }
+    for(std::size_t i=0; i<a.size(); ++i) {
+      if(a[i].size() != b[i].size() || !std::equal(a[i].begin(), a[i].end(), b[i].begin())) { return false; }
+    }
+    return true;
+  };
+  assert(equal(omega_forward, w.forward) && equal(omega_backward, w.backward));
+  assert(equal(receive_mask_forward, w.receive_mask_forward) && equal(receive_mask_backward, w.receive_mask_backward));
+#endif
+}
+
+// old factors keep their relative order in ordering, hence weights of factors not affected by additions stay the same.
+template<typename FMC>
+void LP<FMC>::UpdateAnisotropicWeights(
+    const std::vector<FactorTypeAdapter*>& ordering, const std::vector<INDEX>& f_sorted, const std::vector<bool>& had_weights,
+    const std::unordered_set<FactorTypeAdapter*>& affected,
+    weight_array& omega, receive_array& receive_mask)
+{
+  assert(ordering.size() == f_.size() && f_sorted.size() == f_.size());
+  std::vector<INDEX> position(f_.size());
+  for(INDEX p=0; p<f_sorted.size(); ++p) {
+    position[f_sorted[p]] = p;
+  }
+  auto factor_position = [&](FactorTypeAdapter* f) {
+    assert(factor_address_to_index_.count(f) > 0);
+    return position[factor_address_to_index_.find(f)->second];
+  };
+
+  weight_array updated_omega = allocate_omega(ordering.begin(), ordering.end());
+  receive_array updated_receive_mask = allocate_receive_mask(ordering.begin(), ordering.end());
+
+  std::size_t old_c = 0;
+  std::size_t c = 0;
+  for(INDEX p=0; p<f_sorted.size(); ++p) {
+    auto* f = ordering[p];
+    if(!f->FactorUpdated()) { continue; }
+    // factors without messages before additions have no row in omega
+    const bool old_factor = f_sorted[p] < had_weights.size() && had_weights[f_sorted[p]];
+    if(old_factor && affected.count(f) == 0) {
+      assert(omega[old_c].size() == updated_omega[c].size() && receive_mask[old_c].size() == updated_receive_mask[c].size());
+      std::copy(omega[old_c].begin(), omega[old_c].end(), updated_omega[c].begin());
+      std::copy(receive_mask[old_c].begin(), receive_mask[old_c].end(), updated_receive_mask[c].begin());
+    } else {
+      compute_anisotropic_weights(f, factor_position, updated_omega[c], updated_receive_mask[c]);
+    }
+    if(old_factor) { ++old_c; }
+    ++c;
+  }
+  assert(old_c == omega.size() && c == updated_omega.size());
+
+  omega = std::move(updated_omega);
+  receive_mask = std::move(updated_receive_mask);
+}
+
+// anisotropic weights of a single factor, as computed by ComputeAnisotropicWeights when iterating over all factors
+template<typename FMC>
+template<typename POSITION_OP, typename OMEGA, typename RECEIVE_MASK>
+void LP<FMC>::compute_anisotropic_weights(FactorTypeAdapter* factor, POSITION_OP factor_position, OMEGA omega, RECEIVE_MASK receive_mask)
+{
+  // number of later factors receiving from f, first and last of them
+  auto receiving_factors = [&](FactorTypeAdapter* f, const std::size_t f_index) {
+    std::size_t no_receiving_later = 0;
+    std::size_t first = std::numeric_limits<std::size_t>::max();
+    std::size_t last = 0;
+    for(const auto m : f->get_messages()) {
+      const auto adjacent_index = factor_position(m.adjacent_factor);
+      if(m.adjacent_factor_receives && adjacent_index > f_index) {
+        no_receiving_later++;
+        first = std::min(first, adjacent_index);
+        last = std::max(last, adjacent_index);
+      }
+    }
+    return std::array<std::size_t,3>{no_receiving_later, first, last};
+  };
 
-  omega_valid(omegaForwardAnisotropic_);
-  omega_valid(omegaBackwardAnisotropic_);
+  const auto factor_index = factor_position(factor);
+  const std::size_t no_receiving_factors_later = receiving_factors(factor, factor_index)[0];
+  std::size_t k_send = 0;
+  std::size_t k_receive = 0;
+  for(const auto m : factor->get_messages()) {
+    auto* adjacent_factor = m.adjacent_factor;
+    assert(adjacent_factor != factor);
+    const auto adjacent_factor_index = factor_position(adjacent_factor);
+    const auto adjacent_receiving = receiving_factors(adjacent_factor, adjacent_factor_index);
+    if(m.sends_to_adjacent_factor) {
+      const bool sends = (factor_index < adjacent_factor_index && adjacent_factor->FactorUpdated()) || adjacent_receiving[2] > factor_index;
+      omega[k_send++] = sends ? 1.0 : 0.0;
+    }
+    if(m.receives_from_adjacent_factor) {
+      const bool receives = adjacent_factor_index < factor_index || adjacent_receiving[1] < factor_index;
+      receive_mask[k_receive++] = receives ? 1 : 0;
+    }
+  }
+  assert(k_send == factor->no_send_messages());
+  assert(k_receive == factor->no_receive_messages());
+
+  const std::size_t no_send_messages_anisotropic = std::count(omega.begin(), omega.end(), 1.0);
+  const auto no_send_messages = factor->no_send_messages();
+  const auto srmp_weight = 1.0/double(no_receiving_factors_later + std::max(no_send_messages_anisotropic, no_send_messages - no_send_messages_anisotropic));
+  if(no_send_messages_anisotropic > 0) {
+    for(auto& x : omega) { if(x > 0) { x *= srmp_weight; } }
+  }
 }
 
 template<typename FMC>
 inline void LP<FMC>::ComputeAnisotropicWeights2()
 {
-  ComputeAnisotropicWeights2(forwardOrdering_.begin(), forwardOrdering_.end(), f_forward_sorted_.begin(), f_forward_sorted_.end(), omegaForwardAnisotropic2_, receive_mask_anisotropic2_forward_);
-  ComputeAnisotropicWeights2(backwardOrdering_.begin(), backwardOrdering_.end(), f_backward_sorted_.begin(), f_backward_sorted_.end(), omegaBackwardAnisotropic2_, receive_mask_anisotropic2_backward_);
+  auto& w = get_weight_set(LPReparametrizationMode::Anisotropic2);
+  ComputeAnisotropicWeights2(forwardOrdering_.begin(), forwardOrdering_.end(), f_forward_sorted_.begin(), f_forward_sorted_.end(), w.forward, w.receive_mask_forward);
+  ComputeAnisotropicWeights2(backwardOrdering_.begin(), backwardOrdering_.end(), f_backward_sorted_.begin(), f_backward_sorted_.end(), w.backward, w.receive_mask_backward);
 
-  omega_valid(omegaForwardAnisotropic2_);
-  omega_valid(omegaBackwardAnisotropic2_);
+  omega_valid(w.forward);
+  omega_valid(w.backward);
 }
 
 template<typename FMC>
 inline void LP<FMC>::ComputeUniformWeights()
 {
-  ComputeUniformWeights(forwardOrdering_.begin(), forwardOrdering_.end(), omegaForwardIsotropic_, 0.0);
-  ComputeUniformWeights(backwardOrdering_.begin(), backwardOrdering_.end(), omegaBackwardIsotropic_, 0.0);
+  auto& w = get_weight_set(LPReparametrizationMode::Uniform);
+  ComputeUniformWeights(forwardOrdering_.begin(), forwardOrdering_.end(), w.forward, 0.0);
+  ComputeUniformWeights(backwardOrdering_.begin(), backwardOrdering_.end(), w.backward, 0.0);
 
-  omega_valid(omegaForwardIsotropic_);
-  omega_valid(omegaBackwardIsotropic_);
+  omega_valid(w.forward);
+  omega_valid(w.backward);
 
-  assert(this->backwardUpdateOrdering_.size() == omegaBackwardIsotropic_.size());
+  assert(this->backwardUpdateOrdering_.size() == w.backward.size());
   for(auto it = this->backwardUpdateOrdering_.begin(); it != this->backwardUpdateOrdering_.end(); ++it) {
-    assert((*it)->no_send_messages() == omegaBackwardIsotropic_[ std::distance(this->backwardUpdateOrdering_.begin(), it) ].size());
+    assert((*it)->no_send_messages() == w.backward[ std::distance(this->backwardUpdateOrdering_.begin(), it) ].size());
   } 
 
   for(auto it = this->forwardUpdateOrdering_.begin(); it != this->forwardUpdateOrdering_.end(); ++it) {
-    assert((*it)->no_send_messages() == omegaForwardIsotropic_[ std::distance(this->forwardUpdateOrdering_.begin(), it) ].size());
+    assert((*it)->no_send_messages() == w.forward[ std::distance(this->forwardUpdateOrdering_.begin(), it) ].size());
   } 
 }
 
 template<typename FMC>
 inline void LP<FMC>::ComputeDampedUniformWeights()
 {
-  ComputeUniformWeights(forwardOrdering_.begin(), forwardOrdering_.end(), omegaForwardIsotropicDamped_, 1.0);
-  ComputeUniformWeights(backwardOrdering_.begin(), backwardOrdering_.end(), omegaBackwardIsotropicDamped_, 1.0);
+  auto& w = get_weight_set(LPReparametrizationMode::DampedUniform);
+  ComputeUniformWeights(forwardOrdering_.begin(), forwardOrdering_.end(), w.forward, 1.0);
+  ComputeUniformWeights(backwardOrdering_.begin(), backwardOrdering_.end(), w.backward, 1.0);
+
+  omega_valid(w.forward);
+  omega_valid(w.backward);
+}
+
+template<typename FMC>
+void LP<FMC>::evict_weights(const LPReparametrizationMode m)
+{
+  get_weight_set(m) = weight_set{};
+
+  // full receive mask is only needed by non-anisotropic modes
+  const bool full_receive_mask_used = 
+    get_weight_set(LPReparametrizationMode::Uniform).valid ||
+    get_weight_set(LPReparametrizationMode::DampedUniform).valid ||
+    get_weight_set(LPReparametrizationMode::Mixed).valid;
+  if(!full_receive_mask_used) {
+    full_receive_mask_valid_ = false;
+    full_receive_mask_forward_ = receive_array{};
+    full_receive_mask_backward_ = receive_array{};
+  }
+}
 
-  omega_valid(omegaForwardIsotropicDamped_);
-  omega_valid(omegaBackwardIsotropicDamped_);
+template<typename FMC>
+void LP<FMC>::evict_weights()
+{
+  for(auto& w : weight_sets_) {
+    w = weight_set{};
+  }
+  full_receive_mask_valid_ = false;
+  full_receive_mask_forward_ = receive_array{};
+  full_receive_mask_backward_ = receive_array{};
+}
+
+template<typename FMC>
+void LP<FMC>::evict_least_recently_used_weights()
+{
+  const std::size_t max_weight_sets = max_weight_sets_arg_.getValue();
+  if(max_weight_sets == 0) { return; }
+
+  std::size_t no_valid_sets = std::count_if(weight_sets_.begin(), weight_sets_.end(), [](const auto& w) { return w.valid; });
+  while(no_valid_sets >= max_weight_sets) {
+    std::size_t lru = weight_sets_.size();
+    for(std::size_t i=0; i<weight_sets_.size(); ++i) {
+      if(weight_sets_[i].valid && (lru == weight_sets_.size() || weight_sets_[i].last_use < weight_sets_[lru].last_use)) {
+        lru = i;
+      }
+    }
+    assert(lru < weight_sets_.size());
+    if(debug()) { std::cout << "evict reparametrization weights " << lru << "\n"; }
+    evict_weights(static_cast<LPReparametrizationMode>(lru));
+    --no_valid_sets;
+  }
+}
+
+template<typename FMC>
+std::size_t LP<FMC>::weights_size_in_bytes() const
+{
+  std::size_t s = full_receive_mask_forward_.size_in_bytes() + full_receive_mask_backward_.size_in_bytes();
+  for(const auto& w : weight_sets_) {
+    s += w.forward.size_in_bytes() + w.backward.size_in_bytes() + w.receive_mask_forward.size_in_bytes() + w.receive_mask_backward.size_in_bytes();
+  }
+  return s;
 }
 
 // Here we check whether messages constraints are satisfied
@@ -1191,7 +1714,7 @@ inline weight_array LP<FMC>::allocate_omega(ITERATOR factor_begin, ITERATOR fact
    }
 
    omega_size.resize(c);
-   weight_array omega(omega_size);
+   weight_array omega(uninitialized, omega_size); // all entries are set by the caller
 
    assert(omega.size() == omega_size.size());
    for(INDEX i=0; i<omega.size(); ++i) {
@@ -1215,7 +1738,7 @@ inline receive_array LP<FMC>::allocate_receive_mask(ITERATOR factor_begin, ITERA
    }
 
    receive_mask_size.resize(c);
-   receive_array receive_mask(receive_mask_size);
+   receive_array receive_mask(uninitialized, receive_mask_size); // all entries are set by the caller
 
    assert(receive_mask.size() == receive_mask_size.size());
    for(INDEX i=0; i<receive_mask.size(); ++i) {
@@ -1448,22 +1971,28 @@ void LP<FMC>::ComputeUniformWeights(
    assert(c == omega.size());
 }
 
-// compute anisotropic and damped uniform weights, then average them
+// compute anisotropic and damped uniform weights, then average them. The intermediate weights are not kept.
 template<typename FMC>
 void LP<FMC>::ComputeMixedWeights()
 {
-  assert(false); // check for valid flags!
-  ComputeDampedUniformWeights();
-  ComputeAnisotropicWeights();
-  ComputeMixedWeights(omegaForwardAnisotropic_, omegaForwardIsotropicDamped_, omegaForwardMixed_);
-  ComputeMixedWeights(omegaBackwardAnisotropic_, omegaBackwardIsotropicDamped_, omegaBackwardMixed_);
+  auto& w = get_weight_set(LPReparametrizationMode::Mixed);
+  weight_array omega_anisotropic, omega_damped_uniform;
+  receive_array anisotropic_receive_mask;
+
+  ComputeAnisotropicWeights(forwardOrdering_.begin(), forwardOrdering_.end(), omega_anisotropic, anisotropic_receive_mask);
+  ComputeUniformWeights(forwardOrdering_.begin(), forwardOrdering_.end(), omega_damped_uniform, 1.0);
+  ComputeMixedWeights(omega_anisotropic, omega_damped_uniform, w.forward);
+
+  ComputeAnisotropicWeights(backwardOrdering_.begin(), backwardOrdering_.end(), omega_anisotropic, anisotropic_receive_mask);
+  ComputeUniformWeights(backwardOrdering_.begin(), backwardOrdering_.end(), omega_damped_uniform, 1.0);
+  ComputeMixedWeights(omega_anisotropic, omega_damped_uniform, w.backward);
 } 
 
 template<typename FMC>
 inline void LP<FMC>::ComputeMixedWeights(
-      const two_dim_variable_array<REAL>& omega_anisotropic,
-      const two_dim_variable_array<REAL>& omega_damped_uniform,
-      two_dim_variable_array<REAL>& omega)
+      const weight_array& omega_anisotropic,
+      const weight_array& omega_damped_uniform,
+      weight_array& omega)
 {
    omega = omega_anisotropic;
    
@@ -1495,12 +2024,7 @@ void LP<FMC>::compute_full_receive_mask(FACTOR_ITERATOR factor_begin, FACTOR_ITE
             mask_size.push_back( (*it)->no_receive_messages() );
         } 
     }
-    receive_mask = receive_array(mask_size); 
-    for(std::size_t i=0; i<receive_mask.size(); ++i) {
-        for(std::size_t j=0; j<receive_mask[i].size(); ++j) {
-            receive_mask(i,j) = true;
-        }
-    }
+    receive_mask = receive_array(mask_size.begin(), mask_size.end(), true); 
 
 }
 
@@ -1586,7 +2110,7 @@ void LP<FMC>::ComputePassAndPrimal(FACTOR_ITERATOR factor_begin, const FACTOR_IT
         } 
     }
 
-    ComputePassAndPrimal(filtered_factors_update.begin(), filtered_factors_update.end(), omega.begin(), receive_mask.begin(), iteration);
+    visit_weights(omega, receive_mask, [&](auto omega_it, auto receive_mask_it) { ComputePassAndPrimal(filtered_factors_update.begin(), filtered_factors_update.end(), omega_it, receive_mask_it, iteration); });
 }
 
 template<typename FMC>
@@ -1623,13 +2147,42 @@ template<typename FMC>
 void LP<FMC>::set_flags_dirty()
 {
   ordering_valid_ = false;
-  omega_anisotropic_valid_ = false;
-  omega_anisotropic2_valid_ = false;
-  omega_isotropic_valid_ = false;
-  omega_isotropic_damped_valid_ = false;
-  omega_mixed_valid_ = false;
+  incremental_ordering_ = false;
+  wavefronts_valid_ = false;
+  evict_weights();
+  changed_factors_.clear();
+  factor_partition_valid_ = false;
+#ifdef LP_MP_PARALLEL
+  synchronization_valid_ = false;
+#endif
+}
+
+template<typename FMC>
+void LP<FMC>::set_flags_added(FactorTypeAdapter* f1, FactorTypeAdapter* f2)
+{
+  if(ordering_valid_) {
+    ordering_valid_ = false;
+    incremental_ordering_ = true;
+  }
+  wavefronts_valid_ = false;
+
+  for(std::size_t i=0; i<weight_sets_.size(); ++i) {
+    const auto m = static_cast<LPReparametrizationMode>(i);
+    if(m != LPReparametrizationMode::Anisotropic) {
+      evict_weights(m);
+    }
+  }
+  auto& w = get_weight_set(LPReparametrizationMode::Anisotropic);
+  if(w.valid) {
+    w.valid = false;
+    w.stale = true;
+  }
+  if(w.stale) {
+    if(f1 != nullptr) { changed_factors_.push_back(f1); }
+    if(f2 != nullptr) { changed_factors_.push_back(f2); }
+  }
+
   factor_partition_valid_ = false;
-  full_receive_mask_valid_ = false;
 #ifdef LP_MP_PARALLEL
   synchronization_valid_ = false;
 #endif
@@ -1721,12 +2274,22 @@ inline void LP<FMC>::construct_factor_partition()
 
     SortFactors();
 
+#ifdef LP_MP_PARALLEL
+    concurrent_union_find uf(f_.size());
+#pragma omp parallel for
+    for(std::size_t k=0; k<partition_graph.size(); ++k) {
+        const auto i = factor_address_to_index_.find(partition_graph[k][0])->second;
+        const auto j = factor_address_to_index_.find(partition_graph[k][1])->second;
+        uf.merge(i,j);
+    }
+#else
     union_find uf(f_.size());
     for(auto p : partition_graph) {
         const auto i = factor_address_to_index_[p[0]];
         const auto j = factor_address_to_index_[p[1]];
         uf.merge(i,j);
     }
+#endif
     auto contiguous_ids = uf.get_contiguous_ids();
     std::vector<INDEX> partition_size(uf.count(),0);
     for(std::size_t i=0; i<contiguous_ids.size(); ++i) {
@@ -1934,13 +2497,13 @@ void LP<FMC>::compute_partition_pass(const std::size_t no_passes)
     construct_factor_partition();
     for(std::size_t i=0; i<factor_partition_.size(); ++i) {
         for(std::size_t iter=0; iter<no_passes; ++iter) {
-            ComputePass(factor_partition_[i].begin(), factor_partition_[i].end(), omega_partition_forward_[i].begin(), receive_mask_partition_forward_[i].begin());
-            ComputePass(factor_partition_[i].rbegin(), factor_partition_[i].rend(), omega_partition_backward_[i].begin(), receive_mask_partition_backward_[i].begin());
+            visit_weights(omega_partition_forward_[i], receive_mask_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass(factor_partition_[i].begin(), factor_partition_[i].end(), omega_it, receive_mask_it); });
+            visit_weights(omega_partition_backward_[i], receive_mask_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass(factor_partition_[i].rbegin(), factor_partition_[i].rend(), omega_it, receive_mask_it); });
         } 
         // push all messages forward
         if(i < factor_partition_.size()-1) {
             auto f = concatenate_factors(factor_partition_[i].begin(), factor_partition_[i].end(), factor_partition_[i+1].rbegin(), factor_partition_[i+1].rend());
-            ComputePass(f.begin(), f.end(), omega_partition_forward_pass_push_[i].begin(), receive_mask_partition_forward_pass_push_[i].begin());
+            visit_weights(omega_partition_forward_pass_push_[i], receive_mask_partition_forward_pass_push_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass(f.begin(), f.end(), omega_it, receive_mask_it); });
         }
         //ComputePass(factor_partition_[i].begin(), factor_partition_[i].end(), omega_partition_forward_pass_push_forward_[i].begin(), receive_mask_partition_forward_pass_push_forward_[i].begin());
         //ComputePass(factor_partition_[i].rbegin(), factor_partition_[i].rend(), omega_partition_backward_pass_push_forward_[i].begin(), receive_mask_partition_backward_pass_push_forward_[i].begin());
@@ -1949,13 +2512,13 @@ void LP<FMC>::compute_partition_pass(const std::size_t no_passes)
     for(std::size_t ri=0; ri<factor_partition_.size(); ++ri) {
         const std::size_t i = factor_partition_.size() - ri - 1;
         for(std::size_t iter=0; iter<no_passes; ++iter) {
-            ComputePass(factor_partition_[i].begin(), factor_partition_[i].end(), omega_partition_forward_[i].begin(), receive_mask_partition_forward_[i].begin());
-            ComputePass(factor_partition_[i].rbegin(), factor_partition_[i].rend(), omega_partition_backward_[i].begin(), receive_mask_partition_backward_[i].begin());
+            visit_weights(omega_partition_forward_[i], receive_mask_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass(factor_partition_[i].begin(), factor_partition_[i].end(), omega_it, receive_mask_it); });
+            visit_weights(omega_partition_backward_[i], receive_mask_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass(factor_partition_[i].rbegin(), factor_partition_[i].rend(), omega_it, receive_mask_it); });
         } 
         // push all messages backward
         if(i != 0) {
             auto f = concatenate_factors(factor_partition_[i].begin(), factor_partition_[i].end(), factor_partition_[i-1].rbegin(), factor_partition_[i-1].rend());
-            ComputePass(f.begin(), f.end(), omega_partition_backward_pass_push_[ri].begin(), receive_mask_partition_backward_pass_push_[ri].begin());
+            visit_weights(omega_partition_backward_pass_push_[ri], receive_mask_partition_backward_pass_push_[ri], [&](auto omega_it, auto receive_mask_it) { ComputePass(f.begin(), f.end(), omega_it, receive_mask_it); });
         }
         //ComputePass(factor_partition_[i].begin(), factor_partition_[i].end(), omega_partition_forward_pass_push_backward_[ri].begin(), receive_mask_partition_forward_pass_push_backward_[ri].begin());
         //ComputePass(factor_partition_[i].rbegin(), factor_partition_[i].rend(), omega_partition_backward_pass_push_backward_[ri].begin(), receive_mask_partition_backward_pass_push_backward_[ri].begin());
@@ -1974,10 +2537,10 @@ void LP<FMC>::compute_overlapping_partition_pass(const std::size_t no_passes)
             auto f_forward = concatenate_factors(factor_partition_[i].begin(), factor_partition_[i].end(), factor_partition_[i+1].rbegin(), factor_partition_[i+1].rend());
             auto f_backward = concatenate_factors(factor_partition_[i+1].begin(), factor_partition_[i+1].end(), factor_partition_[i].rbegin(), factor_partition_[i].rend());
             for(std::size_t iter=0; iter<no_passes; ++iter) {
-                ComputePass( f_forward.begin(), f_forward.end(), omega_overlapping_partition_forward_[i].begin(), receive_mask_overlapping_partition_forward_[i].begin());
-                ComputePass( f_backward.begin(), f_backward.end(), omega_overlapping_partition_backward_[i].begin(), receive_mask_overlapping_partition_backward_[i].begin());
+                visit_weights(omega_overlapping_partition_forward_[i], receive_mask_overlapping_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_forward.begin(), f_forward.end(), omega_it, receive_mask_it); });
+                visit_weights(omega_overlapping_partition_backward_[i], receive_mask_overlapping_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_backward.begin(), f_backward.end(), omega_it, receive_mask_it); });
             }
-            ComputePass( f_forward.begin(), f_forward.end(), omega_overlapping_partition_forward_[i].begin(), receive_mask_overlapping_partition_forward_[i].begin());
+            visit_weights(omega_overlapping_partition_forward_[i], receive_mask_overlapping_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_forward.begin(), f_forward.end(), omega_it, receive_mask_it); });
         }
     };
 
@@ -1989,10 +2552,10 @@ void LP<FMC>::compute_overlapping_partition_pass(const std::size_t no_passes)
             auto f_backward = concatenate_factors(factor_partition_[i+1].begin(), factor_partition_[i+1].end(), factor_partition_[i].rbegin(), factor_partition_[i].rend());
 
             for(std::size_t iter=0; iter<no_passes; ++iter) {
-                ComputePass( f_backward.begin(), f_backward.end(), omega_overlapping_partition_backward_[i].begin(), receive_mask_overlapping_partition_backward_[i].begin());
-                ComputePass( f_forward.begin(), f_forward.end(), omega_overlapping_partition_forward_[i].begin(), receive_mask_overlapping_partition_forward_[i].begin());
+                visit_weights(omega_overlapping_partition_backward_[i], receive_mask_overlapping_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_backward.begin(), f_backward.end(), omega_it, receive_mask_it); });
+                visit_weights(omega_overlapping_partition_forward_[i], receive_mask_overlapping_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_forward.begin(), f_forward.end(), omega_it, receive_mask_it); });
             }
-            ComputePass( f_backward.begin(), f_backward.end(), omega_overlapping_partition_backward_[i].begin(), receive_mask_overlapping_partition_backward_[i].begin());
+            visit_weights(omega_overlapping_partition_backward_[i], receive_mask_overlapping_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_backward.begin(), f_backward.end(), omega_it, receive_mask_it); });
         } 
     };
 
@@ -2031,10 +2594,10 @@ void LP<FMC>::compute_overlapping_partition_pass(const std::size_t no_passes)
         auto f_forward = concatenate_factors(factor_partition_[i].begin(), factor_partition_[i].end(), factor_partition_[i+1].rbegin(), factor_partition_[i+1].rend());
         auto f_backward = concatenate_factors(factor_partition_[i+1].begin(), factor_partition_[i+1].end(), factor_partition_[i].rbegin(), factor_partition_[i].rend());
         for(std::size_t iter=0; iter<no_passes; ++iter) {
-            ComputePass( f_forward.begin(), f_forward.end(), omega_overlapping_partition_forward_[i].begin(), receive_mask_overlapping_partition_forward_[i].begin());
-            ComputePass( f_backward.begin(), f_backward.end(), omega_overlapping_partition_backward_[i].begin(), receive_mask_overlapping_partition_backward_[i].begin());
+            visit_weights(omega_overlapping_partition_forward_[i], receive_mask_overlapping_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_forward.begin(), f_forward.end(), omega_it, receive_mask_it); });
+            visit_weights(omega_overlapping_partition_backward_[i], receive_mask_overlapping_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_backward.begin(), f_backward.end(), omega_it, receive_mask_it); });
         }
-        ComputePass( f_forward.begin(), f_forward.end(), omega_overlapping_partition_forward_[i].begin(), receive_mask_overlapping_partition_forward_[i].begin());
+        visit_weights(omega_overlapping_partition_forward_[i], receive_mask_overlapping_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_forward.begin(), f_forward.end(), omega_it, receive_mask_it); });
     } 
 
     for(std::size_t ri=1; ri<factor_partition_.size(); ++ri) {
@@ -2043,10 +2606,10 @@ void LP<FMC>::compute_overlapping_partition_pass(const std::size_t no_passes)
         auto f_backward = concatenate_factors(factor_partition_[i+1].begin(), factor_partition_[i+1].end(), factor_partition_[i].rbegin(), factor_partition_[i].rend());
 
         for(std::size_t iter=0; iter<no_passes; ++iter) {
-            ComputePass( f_backward.begin(), f_backward.end(), omega_overlapping_partition_backward_[i].begin(), receive_mask_overlapping_partition_backward_[i].begin());
-            ComputePass( f_forward.begin(), f_forward.end(), omega_overlapping_partition_forward_[i].begin(), receive_mask_overlapping_partition_forward_[i].begin());
+            visit_weights(omega_overlapping_partition_backward_[i], receive_mask_overlapping_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_backward.begin(), f_backward.end(), omega_it, receive_mask_it); });
+            visit_weights(omega_overlapping_partition_forward_[i], receive_mask_overlapping_partition_forward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_forward.begin(), f_forward.end(), omega_it, receive_mask_it); });
         }
-        ComputePass( f_backward.begin(), f_backward.end(), omega_overlapping_partition_backward_[i].begin(), receive_mask_overlapping_partition_backward_[i].begin());
+        visit_weights(omega_overlapping_partition_backward_[i], receive_mask_overlapping_partition_backward_[i], [&](auto omega_it, auto receive_mask_it) { ComputePass( f_backward.begin(), f_backward.end(), omega_it, receive_mask_it); });
     }
 }
 
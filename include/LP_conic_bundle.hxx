@@ -46,13 +46,8 @@ public:
       this->add_weights(&x[0], -1.0);
 
       // compute subgradient
-      objective_value = 0.0;
       ConicBundle::DVector subg(x.size(), 0.0); // this is not so nice!
-      for(auto& t : this->trees_) {
-         t.solve();
-         t.compute_mapped_subgradient(subg);
-         objective_value -= t.primal_cost();
-      }
+      objective_value = -this->solve_trees(subg);
       cut_vals.push_back(objective_value);
       subgradients.push_back(subg);
 
@@ -77,6 +72,20 @@ public:
       return lb;
    }
 
+   // trees are evaluated at the negated center of the bundle method
+   std::vector<REAL> current_multipliers() const
+   {
+      std::vector<REAL> w = this->multipliers();
+      if(cb_solver_.get_dim() > 0) {
+         ConicBundle::DVector center;
+         cb_solver_.get_center(center);
+         for(std::size_t i=0; i<w.size(); ++i) {
+            w[i] -= center[i];
+         }
+      }
+      return w;
+   }
+
 private:
    ConicBundle::CBSolver cb_solver_;
 
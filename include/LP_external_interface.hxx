@@ -4,6 +4,10 @@
 #include "DD_ILP.hxx"
 #include "LP_MP.h"
 #include "external_solver_interface.hxx"
+#include "lp_format_writer.hxx"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 
 // interface to DD_ILP object which builds up the given LP_MP problem for various other solvers.
 // there are two functions a factor must provide, so that the export can take place:
@@ -45,6 +49,102 @@ public:
     s_.write_to_file(filename);
   }
 
+  // write the problem in LP format without building it up in the external solver first.
+  // Rows are streamed to the file while constraints are constructed, such that memory stays bounded by the number of variable groups instead of the model size.
+  void write_lp_file(const std::string& filename)
+  {
+    std::vector<char> buffer(1 << 20);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(filename);
+    if (!file)
+      throw std::runtime_error("Could not open " + filename + " for writing.");
+
+    lp_format_writer w(file);
+    std::vector<lp_format_writer::variable_counters> counters(this->GetNumberOfFactors());
+    auto factor_no = [this](FactorTypeAdapter* f) {
+      const INDEX i = this->factor_address_to_index_.at(f);
+      assert(i < this->GetNumberOfFactors());
+      return i;
+    };
+
+    // record variables of all factors and messages in the order in which rows are written below
+    std::vector<lp_format_writer::variable_counters> message_chunk_counters;
+    w.begin_objective();
+    this->for_each_factor([&](auto* f) {
+      if constexpr (std::remove_pointer_t<decltype(f)>::can_construct_constraints()) {
+        counters[factor_no(f)] = w.get_variable_counters();
+        f->construct_constraints_impl(w);
+        w.set_variable_counters(counters[factor_no(f)]);
+        f->load_costs_impl(w);
+      }
+    });
+    this->for_each_message_type([&](const auto& messages) {
+      if constexpr (std::remove_pointer_t<typename std::decay_t<decltype(messages)>::value_type>::can_construct_constraints()) {
+        for (std::size_t i = 0; i < messages.size(); ++i) {
+          if (i % lp_chunk_size == 0)
+            message_chunk_counters.push_back(w.get_variable_counters());
+          auto* m = messages[i];
+          m->construct_constraints_impl(w, counters[factor_no(m->GetLeftFactor())], counters[factor_no(m->GetRightFactor())]);
+        }
+      }
+    });
+
+    // rows of chunks are generated in parallel and written in chunk order, such that the file does not depend on the number of threads
+    w.begin_constraints();
+    std::size_t chunk_offset = 0;
+    std::vector<std::string> chunk_buffers(lp_chunks_per_batch);
+    auto write_chunks = [&](const auto& items, auto&& chunk_counters, auto&& construct) {
+      const std::size_t no_chunks = (items.size() + lp_chunk_size - 1) / lp_chunk_size;
+      for (std::size_t batch_begin = 0; batch_begin < no_chunks; batch_begin += lp_chunks_per_batch) {
+        const std::size_t batch_end = std::min(no_chunks, batch_begin + lp_chunks_per_batch);
+#pragma omp parallel for schedule(dynamic)
+        for (std::size_t c = batch_begin; c < batch_end; ++c) {
+          std::ostringstream chunk_stream;
+          auto chunk_writer = w.chunk(chunk_stream, chunk_counters(c), chunk_offset + c);
+          const std::size_t end = std::min(items.size(), (c + 1) * lp_chunk_size);
+          for (std::size_t i = c * lp_chunk_size; i < end; ++i)
+            construct(chunk_writer, items[i]);
+          chunk_buffers[c - batch_begin] = chunk_stream.str();
+        }
+        for (std::size_t c = batch_begin; c < batch_end; ++c)
+          file << chunk_buffers[c - batch_begin];
+      }
+      chunk_offset += no_chunks;
+    };
+
+    this->for_each_factor_type([&](const auto& factors) {
+      if constexpr (std::remove_pointer_t<typename std::decay_t<decltype(factors)>::value_type>::can_construct_constraints()) {
+        write_chunks(factors,
+          [&](const std::size_t c) { return counters[factor_no(factors[c * lp_chunk_size])]; },
+          [](lp_format_writer& cw, auto* f) { f->construct_constraints_impl(cw); });
+      }
+    });
+    std::size_t message_chunk_begin = 0;
+    this->for_each_message_type([&](const auto& messages) {
+      if constexpr (std::remove_pointer_t<typename std::decay_t<decltype(messages)>::value_type>::can_construct_constraints()) {
+        write_chunks(messages,
+          [&](const std::size_t c) { return message_chunk_counters[message_chunk_begin + c]; },
+          [&](lp_format_writer& cw, auto* m) {
+            m->construct_constraints_impl(cw, counters[factor_no(m->GetLeftFactor())], counters[factor_no(m->GetRightFactor())]);
+          });
+        message_chunk_begin += (messages.size() + lp_chunk_size - 1) / lp_chunk_size;
+      }
+    });
+
+    w.begin_bounds();
+    this->for_each_factor([&](auto* f) {
+      if constexpr (std::remove_pointer_t<decltype(f)>::can_construct_constraints()) {
+        w.set_variable_counters(counters[factor_no(f)]);
+        f->load_costs_impl(w);
+      }
+    });
+    w.end();
+
+    if (!file.flush())
+      throw std::runtime_error("Could not write " + filename + ".");
+  }
+
   const external_solver& get_external_solver() const { return s_; }
 
 private:
@@ -77,6 +177,10 @@ private:
       f->load_costs(s_);
   }
 
+  // number of factors resp. messages whose rows are generated by one thread at a time, and number of chunks held in memory before being written
+  static constexpr std::size_t lp_chunk_size = 1024;
+  static constexpr std::size_t lp_chunks_per_batch = 256;
+
   external_solver s_;
 
   std::vector<typename DD_ILP::variable_counters> external_variable_counter_;
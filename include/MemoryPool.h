@@ -64,6 +64,8 @@ class MemoryPool
     // Can only allocate one object at a time. n and hint are ignored
     pointer allocate(size_type n = 1, const_pointer hint = 0);
     void deallocate(pointer p, size_type n = 1);
+    // Is p located in one of the blocks of this pool?
+    bool owns(const_pointer p) const noexcept;
 
     size_type max_size() const noexcept;
 
@@ -184,6 +184,22 @@ MemoryPool<T, BlockSize>::deallocate(pointer p, size_type n)
 
 
 
+template <typename T, size_t BlockSize>
+bool
+MemoryPool<T, BlockSize>::owns(const_pointer p)
+const noexcept
+{
+  const uintptr_t address = reinterpret_cast<uintptr_t>(p);
+  for (slot_pointer_ block = currentBlock_; block != nullptr; block = block->next) {
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(block);
+    if (address >= begin && address < begin + BlockSize)
+      return true;
+  }
+  return false;
+}
+
+
+
 template <typename T, size_t BlockSize>
 inline typename MemoryPool<T, BlockSize>::size_type
 MemoryPool<T, BlockSize>::max_size()
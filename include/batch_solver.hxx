@@ -0,0 +1,69 @@
+#ifndef LP_MP_BATCH_SOLVER_HXX
+#define LP_MP_BATCH_SOLVER_HXX
+
+#include "solver.hxx"
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LP_MP {
+
+struct batch_result {
+  int status = 0; // return value of Solve
+  REAL lower_bound = -std::numeric_limits<REAL>::infinity();
+  REAL primal_cost = std::numeric_limits<REAL>::infinity();
+  std::string solution; // textual form of the best primal solution
+};
+
+// solve independent problem instances concurrently on a pool of worker threads.
+// build(solver, i) constructs instance i in a freshly constructed solver. Each instance is constructed, solved and destroyed on the same worker thread:
+// verbosity and the memory pools of factor and message containers are thread local and are hence never shared between instances running at the same time.
+// The first exception thrown while solving an instance is rethrown after all workers have finished.
+template<typename SOLVER, typename BUILD_FUNCTION>
+std::vector<batch_result> solve_batch(const INDEX no_instances, const std::vector<std::string>& options, BUILD_FUNCTION build, INDEX no_threads = 0)
+{
+  if(no_threads == 0) {
+    no_threads = std::max(INDEX(1), INDEX(std::thread::hardware_concurrency()));
+  }
+  no_threads = std::min(no_threads, no_instances);
+
+  std::vector<batch_result> results(no_instances);
+  std::vector<std::exception_ptr> errors(no_instances);
+  std::atomic<INDEX> next_instance(0);
+
+  auto worker = [&]() {
+    for(INDEX i = next_instance++; i < no_instances; i = next_instance++) {
+      try {
+        SOLVER s(options);
+        build(s, i);
+        auto& r = results[i];
+        r.status = s.Solve();
+        r.lower_bound = s.lower_bound();
+        r.primal_cost = s.primal_cost();
+        r.solution = s.best_primal_string();
+      } catch(...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(no_threads);
+  for(INDEX t=0; t<no_threads; ++t) {
+    workers.emplace_back(worker);
+  }
+  for(auto& w : workers) {
+    w.join();
+  }
+
+  for(auto& e : errors) {
+    if(e) { std::rethrow_exception(e); }
+  }
+  return results;
+}
+
+} // namespace LP_MP
+
+#endif // LP_MP_BATCH_SOLVER_HXX
@@ -0,0 +1,535 @@
+#ifndef LP_MP_CHECKPOINT_HXX
+#define LP_MP_CHECKPOINT_HXX
+
+#include "LP_MP.h"
+#include "serialization.hxx"
+#include "factor_archive.hxx"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <cmath>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// binary checkpoint of the full solver state, such that long runs can be resumed. A checkpoint file consists of
+//   header:          magic, format version, structural fingerprint of the model and sizes of the sections below,
+//   dual section:    serialize_dual of all factors in the order of the LP,
+//   primal section:  serialize_primal of all factors,
+//   best primal:     snapshot of the best primal solution in the layout of the primal section, empty if there is none,
+//   state section:   state given by the solver, e.g. iteration, bounds and visitor state.
+// Offsets of individual factors are recomputed from their archive sizes when reading, hence they are not stored.
+// Files are memory mapped and factors are serialized from resp. into the mapping in parallel.
+//
+// background_writer additionally writes checkpoints incrementally: after a full checkpoint, only blocks of the dual, primal and best primal sections that changed
+// are appended to a delta log next to it, compressed as runs of unchanged bytes and XOR-ed changed bytes. read applies the delta log on top of the full checkpoint.
+
+namespace LP_MP {
+
+namespace checkpoint {
+
+constexpr std::uint64_t magic = 0x31504b43504d504c; // "LPMPCKP1"
+constexpr std::uint64_t version = 2;
+
+struct header {
+   std::uint64_t magic;
+   std::uint64_t version;
+   std::uint64_t fingerprint;
+   std::uint64_t no_factors;
+   std::uint64_t dual_size;
+   std::uint64_t primal_size;
+   std::uint64_t best_primal_size;
+   std::uint64_t state_size;
+};
+
+class mapped_file {
+public:
+   // map existing file privately, such that deltas can be applied to the mapping without changing the file
+   mapped_file(const std::string& filename)
+   {
+      fd_ = ::open(filename.c_str(), O_RDONLY);
+      if(fd_ < 0) { throw std::runtime_error("could not open checkpoint " + filename); }
+      struct stat st;
+      if(::fstat(fd_, &st) != 0) { ::close(fd_); throw std::runtime_error("could not read size of checkpoint " + filename); }
+      size_ = st.st_size;
+      map(PROT_READ | PROT_WRITE, MAP_PRIVATE, filename);
+   }
+
+   // create file of given size and map it for writing
+   mapped_file(const std::string& filename, const std::size_t size)
+      : size_(size)
+   {
+      fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if(fd_ < 0) { throw std::runtime_error("could not create checkpoint " + filename); }
+      if(::ftruncate(fd_, size_) != 0) { ::close(fd_); throw std::runtime_error("could not allocate checkpoint " + filename); }
+      map(PROT_READ | PROT_WRITE, MAP_SHARED, filename);
+   }
+
+   mapped_file(const mapped_file&) = delete;
+   mapped_file& operator=(const mapped_file&) = delete;
+
+   ~mapped_file()
+   {
+      if(data_ != nullptr) { ::munmap(data_, size_); }
+      if(fd_ >= 0) { ::close(fd_); }
+   }
+
+   // write back mapped memory before the file is renamed
+   void sync()
+   {
+      if(::msync(data_, size_, MS_SYNC) != 0) { throw std::runtime_error("could not write checkpoint"); }
+   }
+
+   char* data() const { return data_; }
+   std::size_t size() const { return size_; }
+
+private:
+   void map(const int protection, const int flags, const std::string& filename)
+   {
+      if(size_ < sizeof(header)) { ::close(fd_); fd_ = -1; throw std::runtime_error("checkpoint " + filename + " is truncated"); }
+      void* p = ::mmap(nullptr, size_, protection, flags, fd_, 0);
+      if(p == MAP_FAILED) { ::close(fd_); fd_ = -1; throw std::runtime_error("could not map checkpoint " + filename); }
+      data_ = static_cast<char*>(p);
+   }
+
+   int fd_ = -1;
+   char* data_ = nullptr;
+   std::size_t size_ = 0;
+};
+
+// fingerprint of the model structure: archive sizes of all factors and endpoints of all messages
+template<typename LP_TYPE>
+std::uint64_t fingerprint(const LP_TYPE& lp, const std::vector<std::size_t>& dual_offsets, const std::vector<std::size_t>& primal_offsets)
+{
+   std::size_t h = hash::hash_combine(lp.GetNumberOfFactors(), lp.GetNumberOfMessages());
+   for(std::size_t i=0; i+1<dual_offsets.size(); ++i) {
+      h = hash::hash_combine(h, dual_offsets[i+1] - dual_offsets[i]);
+      h = hash::hash_combine(h, primal_offsets[i+1] - primal_offsets[i]);
+   }
+   for(INDEX i=0; i<lp.GetNumberOfMessages(); ++i) {
+      const auto m = lp.GetMessage(i);
+      h = hash::hash_combine(h, lp.get_factor_index(m.left));
+      h = hash::hash_combine(h, lp.get_factor_index(m.right));
+   }
+   return h;
+}
+
+// the best primal solution is stored in the layout of the primal section
+inline std::size_t best_primal_size(const factor_archive<serialization_functor::primal>& best_primal, const std::size_t primal_size)
+{
+   if(best_primal.empty()) { return 0; }
+   if(best_primal.size() != primal_size) { throw std::runtime_error("best primal solution does not fit model"); }
+   return primal_size;
+}
+
+constexpr std::uint64_t delta_magic = 0x31544c44504d504c; // "LPMPDLT1"
+constexpr std::size_t delta_block_size = 4096;
+
+inline std::string delta_filename(const std::string& filename) { return filename + ".delta"; }
+
+// header of a record in the delta log. The record is followed by its payload, i.e. for each changed block its index, compressed size and compressed delta, and by the full state section.
+struct delta_header {
+   std::uint64_t magic;
+   std::uint64_t fingerprint;
+   std::uint64_t no_blocks;
+   std::uint64_t payload_size;
+   std::uint64_t state_size;
+   std::uint64_t checksum; // of payload and state, detects a record torn by an interrupted write
+};
+
+// FNV-1a
+inline std::uint64_t checksum(const char* data, const std::size_t size, std::uint64_t h = 0xcbf29ce484222325)
+{
+   for(std::size_t i=0; i<size; ++i) {
+      h ^= static_cast<unsigned char>(data[i]);
+      h *= 0x100000001b3;
+   }
+   return h;
+}
+
+// encode the change from prev to cur as alternating runs: number of unchanged bytes, number of changed bytes, changed bytes XOR-ed with prev
+inline void compress_delta(const char* cur, const char* prev, const std::size_t size, std::vector<char>& out)
+{
+   constexpr std::size_t max_run = std::numeric_limits<std::uint16_t>::max();
+   std::size_t i = 0;
+   while(i < size) {
+      const std::size_t unchanged_begin = i;
+      while(i < size && cur[i] == prev[i] && i - unchanged_begin < max_run) { ++i; }
+      const std::size_t changed_begin = i;
+      while(i < size && cur[i] != prev[i] && i - changed_begin < max_run) { ++i; }
+      const std::uint16_t run[2] = {std::uint16_t(changed_begin - unchanged_begin), std::uint16_t(i - changed_begin)};
+      out.insert(out.end(), reinterpret_cast<const char*>(run), reinterpret_cast<const char*>(run) + sizeof(run));
+      for(std::size_t k=changed_begin; k<i; ++k) {
+         out.push_back(cur[k] ^ prev[k]);
+      }
+   }
+}
+
+inline void apply_delta(const char* in, const std::size_t compressed_size, char* data, const std::size_t size)
+{
+   const char* end = in + compressed_size;
+   std::size_t i = 0;
+   while(in < end) {
+      std::uint16_t run[2];
+      if(in + sizeof(run) > end) { throw std::runtime_error("corrupt checkpoint delta"); }
+      std::memcpy(run, in, sizeof(run));
+      in += sizeof(run);
+      i += run[0];
+      if(i + run[1] > size || in + run[1] > end) { throw std::runtime_error("corrupt checkpoint delta"); }
+      for(std::size_t k=0; k<run[1]; ++k) {
+         data[i+k] ^= in[k];
+      }
+      in += run[1];
+      i += run[1];
+   }
+}
+
+// byte ranges of the dual section holding contiguous REAL duals, i.e. of factors whose serialize_dual archives exactly their dual_span. Adjacent ranges are merged.
+template<typename LP_TYPE>
+std::vector<std::pair<std::size_t, std::size_t>> real_dual_ranges(const LP_TYPE& lp, const std::vector<std::size_t>& dual_offsets)
+{
+   std::vector<std::pair<std::size_t, std::size_t>> ranges;
+   for(INDEX i=0; i<lp.GetNumberOfFactors(); ++i) {
+      auto* f = lp.GetFactor(i);
+      const std::size_t begin = dual_offsets[i];
+      const std::size_t end = dual_offsets[i+1];
+      if(begin == end || f->dual_span() == nullptr || f->dual_size()*sizeof(REAL) != end - begin) { continue; }
+      if(ranges.size() > 0 && ranges.back().second == begin) {
+         ranges.back().second = end;
+      } else {
+         ranges.push_back({begin, end});
+      }
+   }
+   return ranges;
+}
+
+// Whether block [begin,end) of the dual, primal and best primal sections must be stored. When the tolerance is positive, REAL duals within real_ranges are compared up to it, all other bytes exactly.
+// REALs crossing the block boundary are compared exactly, such that skipped blocks never leave a partially updated value.
+// Skipped blocks keep their previously stored values, hence restored duals deviate by at most the tolerance.
+inline bool block_changed(const char* cur, const char* prev, const std::size_t begin, const std::size_t end, const std::vector<std::pair<std::size_t, std::size_t>>& real_ranges, const REAL tolerance)
+{
+   std::size_t i = begin;
+   if(tolerance > 0.0) {
+      auto r = std::upper_bound(real_ranges.begin(), real_ranges.end(), begin, [](const std::size_t b, const auto& range) { return b < range.second; });
+      for(; r != real_ranges.end() && r->first < end; ++r) {
+         // first REAL of the range starting in the block
+         std::size_t k = r->first >= i ? r->first : r->first + (i - r->first + sizeof(REAL) - 1)/sizeof(REAL)*sizeof(REAL);
+         k = std::min(k, end);
+         if(std::memcmp(cur + i, prev + i, k - i) != 0) { return true; }
+         for(; k + sizeof(REAL) <= std::min(end, r->second); k += sizeof(REAL)) {
+            if(std::memcmp(cur + k, prev + k, sizeof(REAL)) == 0) { continue; }
+            REAL a, b;
+            std::memcpy(&a, cur + k, sizeof(REAL));
+            std::memcpy(&b, prev + k, sizeof(REAL));
+            if(!(std::abs(a - b) <= tolerance)) { return true; }
+         }
+         i = k;
+      }
+   }
+   return std::memcmp(cur + i, prev + i, end - i) != 0;
+}
+
+// apply all complete records of the delta log to the dual, primal and best primal sections. Returns the state section of the last record, or an empty vector if there is none.
+inline std::vector<char> apply_delta_log(const std::string& filename, const header& h, char* data)
+{
+   std::vector<char> state;
+   std::ifstream in(delta_filename(filename), std::ios::binary);
+   if(!in) { return state; }
+   const std::size_t data_size = h.dual_size + h.primal_size + h.best_primal_size;
+   std::vector<char> payload;
+   std::vector<char> record_state;
+   delta_header dh;
+   while(in.read(reinterpret_cast<char*>(&dh), sizeof(dh))) {
+      if(dh.magic != delta_magic || dh.fingerprint != h.fingerprint) { throw std::runtime_error("checkpoint delta log " + delta_filename(filename) + " does not belong to " + filename); }
+      payload.resize(dh.payload_size);
+      record_state.resize(dh.state_size);
+      if(!in.read(payload.data(), payload.size()) || !in.read(record_state.data(), record_state.size())) { break; }
+      if(checksum(record_state.data(), record_state.size(), checksum(payload.data(), payload.size())) != dh.checksum) { break; }
+
+      const char* p = payload.data();
+      const char* payload_end = payload.data() + payload.size();
+      for(std::size_t b=0; b<dh.no_blocks; ++b) {
+         std::uint64_t block[2];
+         if(p + sizeof(block) > payload_end) { throw std::runtime_error("corrupt checkpoint delta"); }
+         std::memcpy(block, p, sizeof(block));
+         p += sizeof(block);
+         const std::size_t begin = block[0]*delta_block_size;
+         if(begin >= data_size || p + block[1] > payload_end) { throw std::runtime_error("corrupt checkpoint delta"); }
+         apply_delta(p, block[1], data + begin, std::min(delta_block_size, data_size - begin));
+         p += block[1];
+      }
+      std::swap(state, record_state);
+   }
+   return state;
+}
+
+// Writes checkpoints in a separate thread. submit copies the dual, primal and best primal sections and the state, which is the only work done by the calling thread.
+// The first checkpoint and every full_interval-th one after it is written in full, the others are appended to the delta log.
+class background_writer {
+public:
+   background_writer(const std::string& filename, const REAL tolerance, const INDEX full_interval)
+      : filename_(filename),
+      tolerance_(tolerance),
+      full_interval_(full_interval)
+   {}
+
+   background_writer(const background_writer&) = delete;
+   background_writer& operator=(const background_writer&) = delete;
+
+   ~background_writer()
+   {
+      if(thread_.joinable()) { thread_.join(); }
+   }
+
+   // returns false without doing anything if the previous checkpoint is still being written
+   template<typename LP_TYPE, typename STATE_FUNC>
+   bool submit(const LP_TYPE& lp, const factor_archive<serialization_functor::primal>& best_primal, STATE_FUNC state)
+   {
+      if(busy_) { return false; }
+      finish();
+
+      const auto dual_offsets = factor_offsets(lp, serialization_functor::dual{});
+      const auto primal_offsets = factor_offsets(lp, serialization_functor::primal{});
+      allocate_archive state_size;
+      state(state_size);
+
+      header h;
+      h.magic = magic;
+      h.version = version;
+      h.fingerprint = fingerprint(lp, dual_offsets, primal_offsets);
+      h.no_factors = lp.GetNumberOfFactors();
+      h.dual_size = dual_offsets.back();
+      h.primal_size = primal_offsets.back();
+      h.best_primal_size = best_primal_size(best_primal, h.primal_size);
+      h.state_size = state_size.size();
+      if(tolerance_ > 0.0) {
+         real_ranges_ = real_dual_ranges(lp, dual_offsets);
+      }
+
+      snapshot_.resize(sizeof(header) + h.dual_size + h.primal_size + h.best_primal_size + h.state_size);
+      std::memcpy(snapshot_.data(), &h, sizeof(header));
+      char* dual_section = snapshot_.data() + sizeof(header);
+      char* primal_section = dual_section + h.dual_size;
+      char* best_primal_section = primal_section + h.primal_size;
+      serialize_factors<save_archive>(lp, dual_section, dual_offsets, serialization_functor::dual{});
+      serialize_factors<save_archive>(lp, primal_section, primal_offsets, serialization_functor::primal{});
+      if(h.best_primal_size > 0) {
+         std::memcpy(best_primal_section, best_primal.data(), h.best_primal_size);
+      }
+      serialization_archive ar(best_primal_section + h.best_primal_size, h.state_size);
+      save_archive sa(ar);
+      state(sa);
+      ar.release_memory();
+
+      busy_ = true;
+      thread_ = std::thread([this,v=INDEX(verbosity)]() {
+         verbosity = v;
+         try {
+            write();
+         } catch(...) {
+            error_ = std::current_exception();
+         }
+         busy_ = false;
+      });
+      return true;
+   }
+
+   // wait until the last submitted checkpoint is written and rethrow errors from writing it
+   void finish()
+   {
+      if(thread_.joinable()) { thread_.join(); }
+      if(error_) {
+         auto e = error_;
+         error_ = nullptr;
+         std::rethrow_exception(e);
+      }
+   }
+
+private:
+   void write()
+   {
+      header h;
+      std::memcpy(&h, snapshot_.data(), sizeof(header));
+      if(baseline_.size() != h.dual_size + h.primal_size + h.best_primal_size || fingerprint_ != h.fingerprint || deltas_since_full_ >= full_interval_) {
+         write_full(h);
+      } else {
+         write_delta(h);
+      }
+   }
+
+   // the delta log of the previous full checkpoint is removed before the new one replaces it, such that an interruption leaves a consistent pair
+   void write_full(const header& h)
+   {
+      const std::string tmp_filename = filename_ + ".tmp";
+      {
+         std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+         out.write(snapshot_.data(), snapshot_.size());
+         if(!out.flush()) { throw std::runtime_error("could not write checkpoint " + tmp_filename); }
+      }
+      std::remove(delta_filename(filename_).c_str());
+      if(std::rename(tmp_filename.c_str(), filename_.c_str()) != 0) {
+         throw std::runtime_error("could not move checkpoint to " + filename_);
+      }
+      baseline_.assign(snapshot_.begin() + sizeof(header), snapshot_.begin() + sizeof(header) + h.dual_size + h.primal_size + h.best_primal_size);
+      fingerprint_ = h.fingerprint;
+      deltas_since_full_ = 0;
+   }
+
+   void write_delta(const header& h)
+   {
+      const std::size_t data_size = h.dual_size + h.primal_size + h.best_primal_size;
+      const char* cur = snapshot_.data() + sizeof(header);
+      payload_.clear();
+      std::uint64_t no_blocks = 0;
+      for(std::size_t begin=0; begin<data_size; begin+=delta_block_size) {
+         const std::size_t end = std::min(data_size, begin + delta_block_size);
+         if(!block_changed(cur, baseline_.data(), begin, end, real_ranges_, tolerance_)) { continue; }
+         const std::size_t block_pos = payload_.size();
+         payload_.resize(block_pos + 2*sizeof(std::uint64_t));
+         compress_delta(cur + begin, baseline_.data() + begin, end - begin, payload_);
+         const std::uint64_t block[2] = {begin/delta_block_size, payload_.size() - block_pos - sizeof(block)};
+         std::memcpy(payload_.data() + block_pos, block, sizeof(block));
+         std::memcpy(baseline_.data() + begin, cur + begin, end - begin);
+         ++no_blocks;
+      }
+
+      const char* state = cur + data_size;
+      delta_header dh;
+      dh.magic = delta_magic;
+      dh.fingerprint = h.fingerprint;
+      dh.no_blocks = no_blocks;
+      dh.payload_size = payload_.size();
+      dh.state_size = h.state_size;
+      dh.checksum = checksum(state, h.state_size, checksum(payload_.data(), payload_.size()));
+
+      std::ofstream out(delta_filename(filename_), std::ios::binary | std::ios::app);
+      out.write(reinterpret_cast<const char*>(&dh), sizeof(dh));
+      out.write(payload_.data(), payload_.size());
+      out.write(state, h.state_size);
+      if(!out.flush()) { throw std::runtime_error("could not write checkpoint delta " + delta_filename(filename_)); }
+      ++deltas_since_full_;
+   }
+
+   const std::string filename_;
+   const REAL tolerance_;
+   const INDEX full_interval_;
+
+   std::thread thread_;
+   std::atomic<bool> busy_{false};
+   std::exception_ptr error_;
+
+   std::vector<char> snapshot_; // header and sections of the last submitted checkpoint
+   std::vector<char> baseline_; // dual, primal and best primal sections as restored from the files written so far
+   std::vector<char> payload_;
+   std::vector<std::pair<std::size_t, std::size_t>> real_ranges_; // dual bytes of the last submitted checkpoint compared up to the tolerance
+   std::uint64_t fingerprint_ = 0;
+   INDEX deltas_since_full_ = 0;
+};
+
+// STATE_FUNC is called with an archive and serializes the solver state into resp. out of it.
+// The checkpoint is first written to a temporary file, such that an interrupted write does not destroy the previous checkpoint.
+template<typename LP_TYPE, typename STATE_FUNC>
+void write(const std::string& filename, const LP_TYPE& lp, const factor_archive<serialization_functor::primal>& best_primal, STATE_FUNC state)
+{
+   const auto dual_offsets = factor_offsets(lp, serialization_functor::dual{});
+   const auto primal_offsets = factor_offsets(lp, serialization_functor::primal{});
+   allocate_archive state_size;
+   state(state_size);
+
+   header h;
+   h.magic = magic;
+   h.version = version;
+   h.fingerprint = fingerprint(lp, dual_offsets, primal_offsets);
+   h.no_factors = lp.GetNumberOfFactors();
+   h.dual_size = dual_offsets.back();
+   h.primal_size = primal_offsets.back();
+   h.best_primal_size = best_primal_size(best_primal, h.primal_size);
+   h.state_size = state_size.size();
+
+   const std::string tmp_filename = filename + ".tmp";
+   {
+      mapped_file file(tmp_filename, sizeof(header) + h.dual_size + h.primal_size + h.best_primal_size + h.state_size);
+      std::memcpy(file.data(), &h, sizeof(header));
+      char* dual_section = file.data() + sizeof(header);
+      char* primal_section = dual_section + h.dual_size;
+      char* best_primal_section = primal_section + h.primal_size;
+      char* state_section = best_primal_section + h.best_primal_size;
+
+      serialize_factors<save_archive>(lp, dual_section, dual_offsets, serialization_functor::dual{});
+      serialize_factors<save_archive>(lp, primal_section, primal_offsets, serialization_functor::primal{});
+      if(h.best_primal_size > 0) {
+         std::memcpy(best_primal_section, best_primal.data(), h.best_primal_size);
+      }
+      serialization_archive ar(state_section, h.state_size);
+      save_archive sa(ar);
+      state(sa);
+      ar.release_memory();
+      file.sync();
+   }
+   std::remove(delta_filename(filename).c_str());
+   if(std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+      throw std::runtime_error("could not move checkpoint to " + filename);
+   }
+}
+
+// best_primal is set up for the model and filled from the checkpoint, or cleared if the checkpoint holds no best primal solution
+template<typename LP_TYPE, typename STATE_FUNC>
+void read(const std::string& filename, const LP_TYPE& lp, factor_archive<serialization_functor::primal>& best_primal, STATE_FUNC state)
+{
+   mapped_file file(filename);
+   header h;
+   std::memcpy(&h, file.data(), sizeof(header));
+   if(h.magic != magic) { throw std::runtime_error(filename + " is not a checkpoint"); }
+   if(h.version != version) { throw std::runtime_error("checkpoint " + filename + " has unsupported version " + std::to_string(h.version)); }
+
+   const auto dual_offsets = factor_offsets(lp, serialization_functor::dual{});
+   const auto primal_offsets = factor_offsets(lp, serialization_functor::primal{});
+   if(h.no_factors != lp.GetNumberOfFactors() || h.dual_size != dual_offsets.back() || h.primal_size != primal_offsets.back() || h.fingerprint != fingerprint(lp, dual_offsets, primal_offsets)) {
+      throw std::runtime_error("checkpoint " + filename + " was written for a different model");
+   }
+   if((h.best_primal_size != 0 && h.best_primal_size != h.primal_size) || file.size() != sizeof(header) + h.dual_size + h.primal_size + h.best_primal_size + h.state_size) {
+      throw std::runtime_error("checkpoint " + filename + " is truncated");
+   }
+
+   char* dual_section = file.data() + sizeof(header);
+   char* primal_section = dual_section + h.dual_size;
+   std::vector<char> delta_state = apply_delta_log(filename, h, dual_section);
+   serialize_factors<load_archive>(lp, dual_section, dual_offsets, serialization_functor::dual{});
+   serialize_factors<load_archive>(lp, primal_section, primal_offsets, serialization_functor::primal{});
+
+   char* best_primal_section = primal_section + h.primal_size;
+   if(h.best_primal_size == 0) {
+      best_primal.clear();
+   } else {
+      best_primal.layout(lp);
+      assert(best_primal.size() == h.best_primal_size);
+      std::memcpy(best_primal.data(), best_primal_section, h.best_primal_size);
+   }
+
+   char* state_section = best_primal_section + h.best_primal_size;
+   std::size_t state_size = h.state_size;
+   if(delta_state.size() > 0) {
+      state_section = delta_state.data();
+      state_size = delta_state.size();
+   }
+   serialization_archive ar(state_section, state_size);
+   load_archive la(ar);
+   state(la);
+   ar.release_memory();
+}
+
+} // namespace checkpoint
+
+} // namespace LP_MP
+
+#endif // LP_MP_CHECKPOINT_HXX
@@ -1,8 +1,11 @@
 #ifndef LP_MP_combiLP_HXX
 #define LP_MP_combiLP_HXX
 
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 #include <unordered_set>
+#include <variant>
 #include <vector>
 
 #include "LP_MP.h"
@@ -37,29 +40,48 @@ public:
   void End() {
     is_ilp_phase_ = true;
 
+    // LP: outside of ILP region, Active: outside of ILP region but adjacent to it, ILP: inside ILP region
     enum class State { LP, Active, ILP };
 
-#ifndef NDEBUG
-    auto state_to_string = [](State s) {
-      switch(s) {
-        case State::LP:
-          return "State::LP";
-        case State::Active:
-          return "State::Active";
-        case State::ILP:
-          return "State::ILP";
-      }
-    };
-#endif
-
     using primals = factor_archive<serialization_functor::primal>;
-    INDEX size_lp, size_active, size_ilp;
-    std::unordered_map<FactorTypeAdapter*, State> factor_states;
+    const INDEX no_factors = this->f_.size();
+    INDEX size_lp = no_factors, size_active = 0, size_ilp = 0;
+    std::vector<State> states(no_factors, State::LP);
+    std::vector<INDEX> ilp; // factors in ILP region in order of addition
+    std::vector<INDEX> active;
+    std::vector<INDEX> added; // factors added to external solver since last call to update_states
     partial_external_solver<EXTERNAL_SOLVER> external_solver;
     primals primals_lp(this->f_.begin(), this->f_.end());
     double lower_bound = -std::numeric_limits<double>::infinity();
     double upper_bound = std::numeric_limits<double>::infinity();
 
+    // Factor graph with dense factor indices, so that each iteration only
+    // visits messages around the boundary of the ILP region.
+    struct edge { INDEX left, right; message_pointer_variant msg; };
+    std::vector<edge> edges;
+    std::vector<INDEX> degree(no_factors, 0);
+    this->for_each_message([&](auto* m) {
+      const INDEX l = this->factor_address_to_index_.find(m->GetLeftFactor())->second;
+      const INDEX r = this->factor_address_to_index_.find(m->GetRightFactor())->second;
+      edges.push_back({l, r, message_pointer_variant(m)});
+      ++degree[l];
+      ++degree[r];
+    });
+    two_dim_variable_array<INDEX> incident_edges(degree.begin(), degree.end());
+    std::fill(degree.begin(), degree.end(), 0);
+    for (INDEX e = 0; e < edges.size(); ++e) {
+      incident_edges(edges[e].left, degree[edges[e].left]++) = e;
+      incident_edges(edges[e].right, degree[edges[e].right]++) = e;
+    }
+    auto other_factor = [&](INDEX e, INDEX i) { return edges[e].left == i ? edges[e].right : edges[e].left; };
+
+    auto add_to_ilp = [&](INDEX i) {
+      if (!external_solver.has_factor(this->f_[i])) {
+        external_solver.add_factor(this->f_[i]);
+        added.push_back(i);
+      }
+    };
+
 #ifndef NDEBUG
     auto check_invariant = [&](bool ilp_must_be_consistent=false) {
       return;
@@ -69,12 +91,11 @@ public:
       // optimality checking by modifying the assignment and checking the
       // bounds.
       primals p(this->f_.begin(), this->f_.end());
-      this->for_each_factor([&](auto* f) {
-        assert(factor_states.find(f) != factor_states.end());
-        if (factor_states[f] == State::LP) {
-          assert(decltype(primals_lp)::check_factor_equality(primals_lp, p, f));
+      for (INDEX i = 0; i < no_factors; ++i) {
+        if (states[i] == State::LP) {
+          assert(decltype(primals_lp)::check_factor_equality(primals_lp, p, this->f_[i]));
         }
-      });
+      }
 
       // Messages inside LP (and ILP if ilp_must_be_consistent set) have to be
       // consistent (messages on borders are always excluded).
@@ -91,90 +112,78 @@ public:
     //   - restores LP and ILP labeling (if primals_ilp != nullptr)
     //   - moves non-optimal "active" factors into ILP
     //   - checks message consistency on boundary (and moves factors into ILP)
+    // Inconsistent messages can only be adjacent to "active" factors, as only
+    // those may have been modified.
     auto update_partition = [&](primals* primals_ilp) {
-      this->for_each_factor([&](auto* f) {
+      for (INDEX i = 0; i < no_factors; ++i)
+        if (states[i] == State::LP)
+          primals_lp.load_factor(this->f_[i]);
+      if (primals_ilp)
+        for (auto i : ilp)
+          primals_ilp->load_factor(this->f_[i]);
+
+      for (auto i : active) {
+        auto* f = this->f_[i];
         assert(f->LowerBound() <= f->EvaluatePrimal() + eps);
-        assert(factor_states.find(f) != factor_states.end());
-        switch (factor_states[f]) {
-        case State::LP:
-          primals_lp.load_factor(f);
-          break;
-        case State::Active:
-          if (f->LowerBound() < f->EvaluatePrimal() - eps) // not locally optimal
-            external_solver.add_factor(f);
-          break;
-        case State::ILP:
-          if (primals_ilp)
-            primals_ilp->load_factor(f);
-          break;
-        };
-      });
+        if (f->LowerBound() < f->EvaluatePrimal() - eps) // not locally optimal
+          add_to_ilp(i);
+      }
 
-      this->for_each_message([&](auto* m) {
-        if (!m->CheckPrimalConsistency()) { // no factor agreement
-#ifndef NDEBUG
-          bool handled = false;
-#endif
-          std::array<FactorTypeAdapter*, 2> tmp = { m->GetLeftFactor(), m->GetRightFactor() };
-          for (auto* f : tmp) {
-            assert(factor_states.find(f) != factor_states.end());
-            if (factor_states[f] == State::Active) {
-              external_solver.add_factor(f);
-#ifndef NDEBUG
-              handled = true;
-#endif
-            }
+      for (auto i : active) {
+        for (auto e : incident_edges[i]) {
+          const bool consistent = std::visit([](auto* m) { return m->CheckPrimalConsistency(); }, edges[e].msg);
+          if (!consistent) { // no factor agreement
+            add_to_ilp(i);
+            const INDEX j = other_factor(e, i);
+            if (states[j] == State::Active)
+              add_to_ilp(j);
           }
-          assert(handled);
         }
-      });
+      }
     };
 
-    // Updates the state of labeling. First LP and ILP parts are set and
-    // afterwards the "active" region is computed. Additionally
-    // size_{lp,active,ilp} are set.
+    // Moves factors added to the external solver into the ILP part and their
+    // LP neighbors into the "active" region. Additionally size_{lp,active,ilp}
+    // are updated.
     auto update_states = [&]() {
-      size_lp = 0; size_active = 0; size_ilp = 0;
-      for (auto* f : this->f_) {
-        assert(factor_states.find(f) != factor_states.end());
-        if (external_solver.has_factor(f)) {
-          factor_states[f] = State::ILP;
-          ++size_ilp;
-        } else {
-          factor_states[f] = State::LP;
-          ++size_lp;
-        }
+      for (auto i : added) {
+        assert(states[i] != State::ILP);
+        if (states[i] == State::LP) --size_lp; else --size_active;
+        states[i] = State::ILP;
+        ++size_ilp;
+        ilp.push_back(i);
       }
-      assert(size_lp + size_active + size_ilp == this->f_.size());
-
-      this->for_each_message([&](auto* m) {
-        auto* lf = m->GetLeftFactor();
-        auto* rf = m->GetRightFactor();
-        assert(factor_states.find(lf) != factor_states.end());
-        assert(factor_states.find(rf) != factor_states.end());
-        auto lfs = factor_states[lf];
-        auto rfs = factor_states[rf];
-        if (lfs == State::LP && rfs == State::ILP) {
-          factor_states[lf] = State::Active;
-          --size_lp;
-          ++size_active;
-        } else if (lfs == State::ILP && rfs == State::LP) {
-          factor_states[rf] = State::Active;
-          --size_lp;
-          ++size_active;
+      for (auto i : added) {
+        for (auto e : incident_edges[i]) {
+          const INDEX j = other_factor(e, i);
+          if (states[j] == State::LP) {
+            states[j] = State::Active;
+            --size_lp;
+            ++size_active;
+            active.push_back(j);
+          }
         }
-      });
-      assert(size_lp + size_active + size_ilp == this->f_.size());
+      }
+      added.clear();
+      active.erase(std::remove_if(active.begin(), active.end(), [&](INDEX i) { return states[i] != State::Active; }), active.end());
+      assert(size_lp + size_active + size_ilp == no_factors);
+      assert(size_active == active.size() && size_ilp == ilp.size());
     };
 
     // Initialize first ILP subproblem.
-    for (auto* f : this->f_)
-      factor_states[f] = State::Active;
+    std::fill(states.begin(), states.end(), State::Active);
+    active.resize(no_factors);
+    std::iota(active.begin(), active.end(), 0);
     update_partition(nullptr);
+    std::fill(states.begin(), states.end(), State::LP);
+    active.clear();
     update_states();
 
     // Iterate until convergence (dirty flag basically signals consistency).
     int iteration = 0;
+    std::size_t bridges_checked = 0; // ilp[0,bridges_checked) were checked for being bridge factors
+    std::size_t messages_added = 0; // messages inside ILP between ilp[0,messages_added) have been added
+    std::vector<char> propagated(no_factors, 0);
     while (external_solver.dirty()) {
 #ifndef NDEBUG
       check_invariant();
@@ -186,12 +195,12 @@ public:
       // reduces the number of iterations.
       if (bridge_factor_optimization_arg_.getValue()) {
         INDEX bridge_count = external_solver.GetNumberOfFactors();
-        this->for_each_factor([&](auto* f) {
-        if (external_solver.has_factor(f))
-          if (f->no_messages() <= 2) // is bridging factor
-            for (auto& msg : f->get_messages())
-              external_solver.add_factor(msg.adjacent_factor);
-        });
+        for (const std::size_t ilp_end = ilp.size(); bridges_checked < ilp_end; ++bridges_checked) {
+          const INDEX i = ilp[bridges_checked];
+          if (this->f_[i]->no_messages() <= 2) // is bridging factor
+            for (auto e : incident_edges[i])
+              add_to_ilp(other_factor(e, i));
+        }
         bridge_count = external_solver.GetNumberOfFactors() - bridge_count;
         std::cout << "CombiLP: Added " << bridge_count << " bridge factors." << std::endl;
         update_states();
@@ -200,20 +209,32 @@ public:
       // Reparametrize border: Improves convergence.
       // TODO: Evaluate if this is really necessary and improves convergence
       // significantly.
-      this->for_each_message([&](auto* m) {
-        auto* l = m->GetLeftFactor();
-        auto* r = m->GetRightFactor();
-        if (external_solver.has_factor(l) && !external_solver.has_factor(r))
-          m->send_message_to_left();
-        if (!external_solver.has_factor(l) && external_solver.has_factor(r))
-          m->send_message_to_right();
-      });
+      for (auto i : active) {
+        for (auto e : incident_edges[i]) {
+          const INDEX j = other_factor(e, i);
+          if (states[j] != State::ILP)
+            continue;
+          std::visit([&](auto* m) {
+            if (edges[e].left == j) {
+              m->send_message_to_left();
+            } else {
+              m->send_message_to_right();
+            }
+          }, edges[e].msg);
+          external_solver.costs_changed(this->f_[j]);
+        }
+      }
 #ifndef NDEBUG
       check_invariant();
 #endif
 
-      // Add messages connecting all factors in the ILP.
-      external_solver.add_messages(*this);
+      // Add messages connecting newly added factors in the ILP.
+      for (; messages_added < ilp.size(); ++messages_added) {
+        const INDEX i = ilp[messages_added];
+        for (auto e : incident_edges[i])
+          if (states[other_factor(e, i)] == State::ILP)
+            std::visit([&](auto* m) { external_solver.add_message(m); }, edges[e].msg);
+      }
 
       ++iteration;
       std::cout << std::endl << "CombiLP iteration " << iteration << ": "
@@ -227,7 +248,11 @@ public:
       const bool solved = external_solver.solve();
       if (!solved)
         throw std::runtime_error("External solver failed to solve the problem.");
-      primals primals_ilp(this->f_.begin(), this->f_.end());
+      std::vector<FactorTypeAdapter*> ilp_factors;
+      ilp_factors.reserve(ilp.size());
+      for (auto i : ilp)
+        ilp_factors.push_back(this->f_[i]);
+      primals primals_ilp(ilp_factors.begin(), ilp_factors.end());
 #ifndef NDEBUG
       check_invariant(true);
 #endif
@@ -235,18 +260,26 @@ public:
       lower_bound = this->LowerBound();
 
       // We now propagate the primal assignment of the boundary regions of the
-      // ILP to the LP. We do it for all ILP nodes, as the ILP part is already
-      // consistent so nothing will happen there (it is unnecessary work
-      // though).
+      // ILP to the LP. The ILP part is already consistent, hence only ILP
+      // factors adjacent to the "active" region need to propagate.
       //
       // Note that this will change the LP part (not only the directly
       // neighboring factors as factors might have "upstream" factors, see e.g.
       // `UnarySimplexFactor`). This will be fixed in `update_partition` (LP
       // part gets restored, "active" part of LP remains modified, as
       // optimality is checked by comparing bounds).
-      for (auto* f : this->f_)
-        if (external_solver.has_factor(f))
-          f->propagate_primal_through_messages();
+      for (auto i : active) {
+        for (auto e : incident_edges[i]) {
+          const INDEX j = other_factor(e, i);
+          if (states[j] == State::ILP && !propagated[j]) {
+            propagated[j] = 1;
+            this->f_[j]->propagate_primal_through_messages();
+          }
+        }
+      }
+      for (auto i : active)
+        for (auto e : incident_edges[i])
+          propagated[other_factor(e, i)] = 0;
 #ifndef NDEBUG
       this->for_each_message([&](auto* m) { assert(m->CheckPrimalConsistency()); });
 #endif
@@ -283,15 +316,20 @@ public:
     // checked. Additionally to the normal `check_invariant` we just make sure
     // that the LP+Active region is really locally optimal.
     check_invariant(true);
-    for (auto* f : this->f_) {
-      assert(factor_states.find(f) != factor_states.end());
-      if (factor_states[f] != State::ILP)
-        assert(std::abs(f->LowerBound() - f->EvaluatePrimal()) <= eps);
+    for (INDEX i = 0; i < no_factors; ++i) {
+      if (states[i] != State::ILP)
+        assert(std::abs(this->f_[i]->LowerBound() - this->f_[i]->EvaluatePrimal()) <= eps);
     }
 #endif
   }
 
 private:
+  struct message_pointer {
+    template<class MESSAGE_CONTAINER_TYPE>
+    using invoke = MESSAGE_CONTAINER_TYPE*;
+  };
+  using message_pointer_variant = meta::apply<meta::quote<std::variant>, meta::transform<typename BASE_LP::FMC::MessageList, message_pointer>>;
+
   TCLAP::SwitchArg bridge_factor_optimization_arg_;
   bool is_ilp_phase_;
 };
@@ -10,6 +10,7 @@
 #include <cmath>
 #include <cassert>
 #include <limits>
+#include <atomic>
 #include "tclap/CmdLine.h"
 
 #define SIMDPP_ARCH_X86_AVX2
@@ -52,9 +53,25 @@ namespace LP_MP {
    // verbosity levels: 0: silent
    //                   1: important diagnostics, e.g. lower bound, upper bound, runtimes
    //                   2: debug informations
-   static INDEX verbosity = 0; 
-   static bool diagnostics() { return verbosity >= 1; }
-   static bool debug() { return verbosity >= 2; }
+   // verbosity is kept per thread, the solver sets it on the thread it runs on. Hence solvers running concurrently on different threads do not interfere.
+   // Threads on which it was never set, e.g. OpenMP workers, use the level that was set last on any thread.
+   class verbosity_level {
+   public:
+      operator INDEX() const { return level_ != unset ? level_ : last_set_.load(std::memory_order_relaxed); }
+      verbosity_level& operator=(const INDEX v)
+      {
+         level_ = v;
+         last_set_.store(v, std::memory_order_relaxed);
+         return *this;
+      }
+   private:
+      static constexpr INDEX unset = std::numeric_limits<INDEX>::max();
+      INDEX level_ = unset;
+      inline static std::atomic<INDEX> last_set_{0};
+   };
+   inline thread_local verbosity_level verbosity;
+   inline bool diagnostics() { return verbosity >= 1; }
+   inline bool debug() { return verbosity >= 2; }
    
    // shortcuts to indicate how many messages a factor holds
    constexpr SIGNED_INDEX variableMessageNumber = 0;
@@ -100,6 +117,7 @@ namespace LP_MP {
       bool tighten = false;
       bool end = false; // terminate optimization
       bool error = false;
+      bool checkpoint = false; // write checkpoint of solver state
       INDEX tightenConstraints = 0; // when given as return type, indicates how many constraints are to be added. When given as parameter to visitor, indicates how many were added.
       REAL tightenMinDualIncrease = 0.0; // do zrobienia: obsolete
    };
@@ -1,7 +1,10 @@
 #ifndef LP_MP_factor_archive_HXX
 #define LP_MP_factor_archive_HXX
 
+#include "LP_MP.h"
+#include "serialization.hxx"
 #include <unordered_map>
+#include <vector>
 
 namespace LP_MP {
 
@@ -12,6 +15,7 @@ struct dual {
   void operator()(FactorTypeAdapter* f, ARCHIVE &a) {
     f->serialize_dual(a);
   }
+  INDEX size_in_bytes(FactorTypeAdapter* f) { return f->dual_size_in_bytes(); }
 };
 
 struct primal {
@@ -19,10 +23,41 @@ struct primal {
   void operator()(FactorTypeAdapter* f, ARCHIVE &a) {
     f->serialize_primal(a);
   }
+  INDEX size_in_bytes(FactorTypeAdapter* f) { return f->primal_size_in_bytes(); }
 };
 
 } // namespace serialization_functor
 
+// byte offsets of the serialized factors of an LP within one contiguous section, offsets[i+1] - offsets[i] is the size of factor i
+template<typename LP_TYPE, typename SERIALIZATION_FUNCTOR>
+std::vector<std::size_t> factor_offsets(const LP_TYPE& lp, SERIALIZATION_FUNCTOR functor)
+{
+  std::vector<std::size_t> offsets(lp.GetNumberOfFactors()+1, 0);
+#pragma omp parallel for schedule(guided)
+  for(INDEX i=0; i<lp.GetNumberOfFactors(); ++i) {
+    offsets[i+1] = functor.size_in_bytes(lp.GetFactor(i));
+  }
+  for(std::size_t i=1; i<offsets.size(); ++i) {
+    offsets[i] += offsets[i-1];
+  }
+  return offsets;
+}
+
+// serialize all factors of an LP from resp. into their byte ranges of a section in parallel.
+// ARCHIVE is save_archive, load_archive or addition_archive (the latter needs a scaling)
+template<typename ARCHIVE, typename LP_TYPE, typename SERIALIZATION_FUNCTOR, typename... ARGS>
+void serialize_factors(const LP_TYPE& lp, const char* section, const std::vector<std::size_t>& offsets, SERIALIZATION_FUNCTOR functor, ARGS... archive_args)
+{
+  assert(offsets.size() == lp.GetNumberOfFactors()+1);
+#pragma omp parallel for schedule(guided)
+  for(INDEX i=0; i<lp.GetNumberOfFactors(); ++i) {
+    serialization_archive ar(section + offsets[i], offsets[i+1] - offsets[i]);
+    ARCHIVE a(ar, archive_args...);
+    functor(lp.GetFactor(i), a);
+    ar.release_memory();
+  }
+}
+
 template<typename SERIALIZATON_FUNCTOR>
 class factor_archive {
 public:
@@ -36,8 +71,11 @@ public:
     allocate_archive aa;
     for (auto it = begin; it != end; ++it) {
       factor_to_index_.insert(std::make_pair(*it, aa.size()));
+      factors_.push_back(*it);
+      offsets_.push_back(aa.size());
       functor(*it, aa);
     }
+    offsets_.push_back(aa.size());
     archive_.aquire_memory(aa.size());
 
     save_archive sa(archive_);
@@ -46,9 +84,65 @@ public:
     }
   }
 
-  // FIXME: LP does not implement this interface.
-  //factor_archive(LP &lp)
-  //: factor_archive(lp.begin(), lp.end()) { }
+  // all factors of an LP, sized and serialized in parallel
+  template<typename FMC>
+  factor_archive(const LP<FMC>& lp)
+  {
+    save(lp);
+  }
+
+  // snapshot all factors of an LP. The layout is only recomputed when factors were added since the last snapshot, otherwise the memory is reused
+  template<typename FMC>
+  void save(const LP<FMC>& lp)
+  {
+    layout(lp);
+    serialize_factors<save_archive>(lp, archive_.begin(), offsets_, functor);
+  }
+
+  // set up offsets and memory for all factors of an LP without serializing them, e.g. before the raw bytes are filled in from a checkpoint
+  template<typename FMC>
+  void layout(const LP<FMC>& lp)
+  {
+    const INDEX n = lp.GetNumberOfFactors();
+    if(factors_.size() != n || (n > 0 && factors_.back() != lp.GetFactor(n-1))) {
+      offsets_ = factor_offsets(lp, functor);
+      factors_.clear();
+      factor_to_index_.clear();
+      factors_.reserve(n);
+      factor_to_index_.reserve(n);
+      for(INDEX i=0; i<n; ++i) {
+        factors_.push_back(lp.GetFactor(i));
+        factor_to_index_.insert(std::make_pair(lp.GetFactor(i), offsets_[i]));
+      }
+      archive_.aquire_memory(offsets_.back());
+    }
+  }
+
+  // write the snapshot back into all archived factors
+  void load()
+  {
+#pragma omp parallel for schedule(guided)
+    for(INDEX i=0; i<factors_.size(); ++i) {
+      serialization_archive ar(archive_.begin() + offsets_[i], offsets_[i+1] - offsets_[i]);
+      load_archive a(ar);
+      functor(factors_[i], a);
+      ar.release_memory();
+    }
+  }
+
+  void clear()
+  {
+    archive_.free_memory();
+    factor_to_index_.clear();
+    factors_.clear();
+    offsets_.clear();
+  }
+
+  bool empty() const { return factors_.empty(); }
+  // raw bytes of the snapshot
+  INDEX size() const { return archive_.size(); }
+  char* data() { return archive_.begin(); }
+  const char* data() const { return archive_.begin(); }
 
   void load_factor(FactorTypeAdapter* f) {
     access<load_archive>(f);
@@ -86,6 +180,8 @@ private:
   SERIALIZATON_FUNCTOR functor;
   serialization_archive archive_;
   std::unordered_map<FactorTypeAdapter*, INDEX> factor_to_index_;
+  std::vector<FactorTypeAdapter*> factors_;
+  std::vector<std::size_t> offsets_;
 
   template<typename ARCHIVE>
   void access(FactorTypeAdapter* f) {
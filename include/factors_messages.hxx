@@ -1602,8 +1602,8 @@ public:
    }
 
    // construct constraints
-   template<typename SOLVER>
-   void construct_constraints_impl(SOLVER& s, const typename DD_ILP::variable_counters& left_variable_counters, const typename DD_ILP::variable_counters& right_variable_counters)
+   template<typename SOLVER, typename VARIABLE_COUNTERS>
+   void construct_constraints_impl(SOLVER& s, const VARIABLE_COUNTERS& left_variable_counters, const VARIABLE_COUNTERS& right_variable_counters)
    {
        if constexpr(can_construct_constraints()) {
            auto current_variable_counters = s.get_variable_counters();
@@ -1799,6 +1799,7 @@ class variable_message_container_storage {
 
         void operator delete(void* mem)
         {
+            assert(Allocator::get().owns((storage_type*) mem)); // chunks must be deallocated on the thread that allocated them, see FactorContainer::Allocator
             Allocator::get().deallocate((storage_type*) mem);
         }
 
@@ -1809,7 +1810,7 @@ class variable_message_container_storage {
         struct Allocator {
             using type = MemoryPool<storage_type,4096*(sizeof(storage_type)+sizeof(void*))>; 
             static type& get() {
-                static type allocator;
+                static thread_local type allocator; // see FactorContainer::Allocator
                 return allocator;
             }
         };
@@ -2177,6 +2178,7 @@ public:
    }
    void operator delete(void* mem)
    {
+      assert(Allocator::get().owns((FactorContainerType*) mem)); // the pool is thread local, see Allocator
       Allocator::get().deallocate((FactorContainerType*) mem);
       //assert(false);
       //global_real_block_allocator.deallocate((double*)mem,sizeof(FactorContainerType)/sizeof(REAL)+1);
@@ -2269,7 +2271,7 @@ public:
 
    void update_factor_residual(const weight_slice omega, const receive_slice receive_mask) final
    {
-      assert(*std::min_element(omega.begin(), omega.end()) >= 0.0);
+      assert(omega.size() == 0 || *std::min_element(omega.begin(), omega.end()) >= 0.0);
       assert(*std::max_element(omega.begin(), omega.end()) <= 1.0+eps);
       assert(std::distance(omega.begin(), omega.end()) == no_send_messages());
       assert(receive_mask.size() == no_receive_messages());
@@ -2281,7 +2283,7 @@ public:
 #ifdef LP_MP_PARALLEL
    void UpdateFactorSynchronized(const weight_slice& omega) final
    {
-      assert(*std::min_element(omega.begin(), omega.end()) >= 0.0);
+      assert(omega.size() == 0 || *std::min_element(omega.begin(), omega.end()) >= 0.0);
       assert(std::accumulate(omega.begin(), omega.end(), 0.0) <= 1.0 + eps);
       assert(std::distance(omega.begin(), omega.end()) == no_send_messages());
       std::lock_guard<std::recursive_mutex> lock(mutex_); // only here do we wait for the mutex. In all other places try_lock is allowed only
@@ -2329,6 +2331,26 @@ public:
       return FunctionExistence::HasMaximizePotential<FactorType,void>();
    }
 
+   // uniform weights and full receive mask, as UpdateFactorPrimal with weights computed by LP::ComputeUniformWeights, but without materialized weights
+   void update_factor_primal_uniform(const REAL leave_weight, INDEX primal_access) final
+   {
+#ifdef LP_MP_PARALLEL
+     std::lock_guard<std::recursive_mutex> lock(mutex_);
+#endif
+      assert(primal_access > 0);
+      conditionally_init_primal(primal_access);
+      receive_messages();
+      if(CanComputePrimal()) {
+         primal_access_ = primal_access;
+         MaximizePotentialAndComputePrimal();
+         send_messages(leave_weight);
+         propagate_primal_through_messages();
+      } else {
+         MaximizePotential();
+         send_messages(leave_weight);
+      }
+   }
+
    void UpdateFactorPrimal(const weight_slice& omega, const receive_slice& receive_mask, INDEX primal_access) final
    {
 #ifdef LP_MP_PARALLEL
@@ -2780,14 +2802,14 @@ public:
            call_send_messages(factor_, send_weight); 
        } else if(no_calls > 1) {
            FactorType tmp_factor(factor_);
-           call_send_messages(factor_, send_weight); 
+           call_send_messages(tmp_factor, send_weight); 
        }
    }
 
    template<typename WEIGHT_VEC>
    void SendMessages(const WEIGHT_VEC& omega) 
    {
-      assert(*std::min_element(omega.begin(), omega.end()) >= 0.0);
+      assert(omega.size() == 0 || *std::min_element(omega.begin(), omega.end()) >= 0.0);
       assert(std::accumulate(omega.begin(), omega.end(), 0.0) <= 1.0 + eps);
       assert(std::distance(omega.begin(), omega.end()) == no_send_messages()); 
 #ifndef NDEBUG
@@ -2859,7 +2881,7 @@ public:
    template<typename WEIGHT_VEC>
    void send_messages_with_adaptive_weights(const WEIGHT_VEC& omega)
    {
-       assert(*std::min_element(omega.begin(), omega.end()) >= 0.0);
+       assert(omega.size() == 0 || *std::min_element(omega.begin(), omega.end()) >= 0.0);
        assert(std::accumulate(omega.begin(), omega.end(), 0.0) <= 1.0 + eps);
        assert(std::distance(omega.begin(), omega.end()) == no_send_messages()); 
 
@@ -3172,6 +3194,22 @@ public:
       return 0;
    }
 
+   struct apply_sparse_subgradient {
+      apply_sparse_subgradient(std::vector<INDEX>& _indices) : indices(_indices) {}
+      void operator[](const INDEX i) { indices.push_back(i); }
+      private:
+      std::vector<INDEX>& indices;
+   };
+   virtual void sparse_subgradient(std::vector<INDEX>& indices) final
+   {
+      if constexpr(can_apply()) {
+        apply_sparse_subgradient a(indices);
+        factor_.apply(a);
+      } else {
+        assert(false);
+      }
+   }
+
    virtual REAL dot_product(double* w) final
    {
       class apply_dot_product {
@@ -3193,20 +3231,35 @@ public:
       return d.dot_product(); 
    }
 
+   // dual variables stored as one contiguous block of REAL are copied resp. added in one go instead of going through the factor's serialize_dual
    virtual void serialize_dual(load_archive& ar) final
-   { factor_.serialize_dual(ar); }
+   {
+      if(REAL* d = dual_span()) { ar.serialize(d, dual_size()); }
+      else { factor_.serialize_dual(ar); }
+   }
    virtual void serialize_primal(load_archive& ar) final
    { factor_.serialize_primal(ar); } 
    virtual void serialize_dual(save_archive& ar) final
-   { factor_.serialize_dual(ar); }
+   {
+      if(REAL* d = dual_span()) { ar.serialize(d, dual_size()); }
+      else { factor_.serialize_dual(ar); }
+   }
    virtual void serialize_primal(save_archive& ar) final
    { factor_.serialize_primal(ar); } 
    virtual void serialize_dual(allocate_archive& ar) final
-   { factor_.serialize_dual(ar); }
+   { ar(binary_data<char>(nullptr, dual_size_in_bytes())); }
    virtual void serialize_primal(allocate_archive& ar) final
    { factor_.serialize_primal(ar); } 
    virtual void serialize_dual(addition_archive& ar) final
-   { factor_.serialize_dual(ar); }
+   {
+      if(REAL* d = dual_span()) { ar.serialize(d, dual_size()); }
+      else { factor_.serialize_dual(ar); }
+   }
+
+   virtual REAL* dual_span() final
+   {
+      return get_dual_layout().span;
+   }
 
    // returns size in bytes
    virtual INDEX dual_size() final
@@ -3216,10 +3269,7 @@ public:
 
    virtual INDEX dual_size_in_bytes() final
    {
-      allocate_archive ar;
-      factor_.serialize_dual(ar);
-      assert(ar.size() % sizeof(REAL) == 0);
-      return ar.size();
+      return get_dual_layout().size_in_bytes;
    }
 
    virtual void divide(const REAL val) final
@@ -3292,6 +3342,33 @@ public:
    
 protected:
    FactorType factor_; // the factor operation
+
+   // layout of the dual variables, determined once by going through serialize_dual of the factor.
+   // Dual storage of factors is not reallocated after construction, hence the contiguous block stays valid. Copies have their own storage and determine their layout anew.
+   struct dual_layout {
+      static constexpr INDEX unknown = std::numeric_limits<INDEX>::max();
+      dual_layout() {}
+      dual_layout(const dual_layout&) {}
+      dual_layout& operator=(const dual_layout&) { size_in_bytes = unknown; span = nullptr; return *this; }
+      INDEX size_in_bytes = unknown;
+      REAL* span = nullptr; // all dual variables if they form one contiguous block of REAL
+   };
+   dual_layout dual_layout_;
+
+   const dual_layout& get_dual_layout()
+   {
+      if(dual_layout_.size_in_bytes == dual_layout::unknown) {
+         allocate_archive size_ar;
+         factor_.serialize_dual(size_ar);
+         assert(size_ar.size() % sizeof(REAL) == 0);
+         dual_span_archive span_ar;
+         factor_.serialize_dual(span_ar);
+         assert(span_ar.begin() == nullptr || span_ar.size()*sizeof(REAL) == size_ar.size());
+         dual_layout_.span = span_ar.begin();
+         dual_layout_.size_in_bytes = size_ar.size();
+      }
+      return dual_layout_;
+   }
 public:
    INDEX primal_access_ = 0; // counts when primal was accessed last, do zrobienia: make setter and getter for clean interface or make MessageContainer a friend
 
@@ -3366,12 +3443,12 @@ public:
 
 protected:
    // pool memory allocator specific for this factor container
-   // note: the below construction is not perfect when more than one solver is run simultaneously: The same allocator is used, yet the optimization problems are different + not thread safe.
-   // -> investigate thread_local inline static! inline static however is only supported in C++17
+   // note: the pool is thread local, such that solvers running on different threads do not share it. Factor containers must therefore be deallocated on the thread that allocated them, see solve_batch.
+   // Solvers and copies of their model (see PortfolioRoundingSolver) are hence constructed and destroyed on one thread, other threads may only work on them. operator delete asserts this.
    struct Allocator { // we enclose static allocator in nested class as only there (since C++11) we can access sizeof(FactorContainerType).
       using type = MemoryPool<FactorContainerType,4096*(sizeof(FactorContainerType)+sizeof(void*))>; 
       static type& get() {
-         static type allocator;
+         static thread_local type allocator;
          return allocator;
       }
    };
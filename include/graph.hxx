@@ -5,6 +5,8 @@
 #include <array>
 #include <algorithm>
 #include <queue>
+#include <iterator>
+#include <type_traits>
 #include "two_dimensional_variable_array.hxx"
 #include "union_find.hxx"
 #include "help_functions.hxx"
@@ -50,8 +52,38 @@ namespace LP_MP {
 		{}
 
 		// compute sorted adjacency list representation of graph given by edges.
+		// For random access edge iterators, degree counting, scattering, sorting and setting sister pointers is parallelized.
 		template<typename EDGE_ITERATOR, typename EDGE_INFORMATION_LAMBDA>
 		graph(EDGE_ITERATOR edge_begin, EDGE_ITERATOR edge_end, EDGE_INFORMATION_LAMBDA f)
+		{
+            using iterator_category = typename std::iterator_traits<EDGE_ITERATOR>::iterator_category;
+            if constexpr(std::is_base_of_v<std::random_access_iterator_tag, iterator_category>) {
+                construct_parallel(edge_begin, edge_end, f);
+            } else {
+                construct_sequential(edge_begin, edge_end, f);
+            }
+            check_graph();
+		}
+
+        void set_sister_pointers()
+        {
+            for(std::size_t i=0; i<edges_.size(); ++i) { assert(std::is_sorted(edges_[i].begin(), edges_[i].end())); }
+            std::vector<std::size_t> adjacency_list_count(edges_.size(), 0);
+			for(std::size_t i=0; i<edges_.size(); ++i) {
+				for(auto edge_it=edges_[i].begin(); edge_it!=edges_[i].end(); ++edge_it) {
+					if(edge_it->head() > i) {
+						const auto head = edge_it->head();
+						auto* sister = &edges_(head, adjacency_list_count[head]++);
+						edge_it->sister_ = sister;
+						sister->sister_ = &(*edge_it);
+					} 
+				} 
+			}
+        }
+
+        private:
+		template<typename EDGE_ITERATOR, typename EDGE_INFORMATION_LAMBDA>
+		void construct_sequential(EDGE_ITERATOR edge_begin, EDGE_ITERATOR edge_end, EDGE_INFORMATION_LAMBDA f)
 		{
 			std::vector<std::size_t> adjacency_list_count;
 			// first determine size for adjacency_list
@@ -85,24 +117,103 @@ namespace LP_MP {
 			}
 
             set_sister_pointers();
-            check_graph();
 		}
 
-        void set_sister_pointers()
-        {
-            for(std::size_t i=0; i<edges_.size(); ++i) { assert(std::is_sorted(edges_[i].begin(), edges_[i].end())); }
-            std::vector<std::size_t> adjacency_list_count(edges_.size(), 0);
-			for(std::size_t i=0; i<edges_.size(); ++i) {
-				for(auto edge_it=edges_[i].begin(); edge_it!=edges_[i].end(); ++edge_it) {
-					if(edge_it->head() > i) {
-						const auto head = edge_it->head();
-						auto* sister = &edges_(head, adjacency_list_count[head]++);
-						edge_it->sister_ = sister;
-						sister->sister_ = &(*edge_it);
-					} 
-				} 
+        // edge number is kept in sister pointer between scattering edges and matching sisters
+        static edge_type* edge_number_to_pointer(const std::size_t e) { return reinterpret_cast<edge_type*>(e); }
+        static std::size_t pointer_to_edge_number(const edge_type* p) { return reinterpret_cast<std::size_t>(p); }
+
+		template<typename EDGE_ITERATOR, typename EDGE_INFORMATION_LAMBDA>
+		void construct_parallel(EDGE_ITERATOR edge_begin, EDGE_ITERATOR edge_end, EDGE_INFORMATION_LAMBDA f)
+		{
+            const std::size_t no_edges = std::distance(edge_begin, edge_end);
+
+            std::size_t no_nodes = 0;
+#pragma omp parallel for reduction(max:no_nodes)
+            for(std::size_t e=0; e<no_edges; ++e) {
+                const std::size_t i = edge_begin[e][0];
+                const std::size_t j = edge_begin[e][1];
+                no_nodes = std::max({no_nodes, i+1, j+1});
+            }
+
+            // node degrees
+            // Atomics are only used in parallel mode, they serialize the mostly cache missing increments otherwise.
+            std::vector<std::size_t> adjacency_list_count(no_nodes, 0);
+#ifdef LP_MP_PARALLEL
+#pragma omp parallel for
+#endif
+            for(std::size_t e=0; e<no_edges; ++e) {
+                const std::size_t i = edge_begin[e][0];
+                const std::size_t j = edge_begin[e][1];
+                assert(i != j);
+#ifdef LP_MP_PARALLEL
+#pragma omp atomic
+#endif
+                adjacency_list_count[i]++;
+#ifdef LP_MP_PARALLEL
+#pragma omp atomic
+#endif
+                adjacency_list_count[j]++;
+            }
+
+            edges_ = two_dim_variable_array<edge_type>(uninitialized, adjacency_list_count.begin(), adjacency_list_count.end());
+            std::fill(adjacency_list_count.begin(), adjacency_list_count.end(), 0);
+
+            // scatter edges into adjacency lists. Positions are claimed atomically, order is restored by sorting afterwards.
+#ifdef LP_MP_PARALLEL
+#pragma omp parallel for
+#endif
+            for(std::size_t e=0; e<no_edges; ++e) {
+                const std::size_t i = edge_begin[e][0];
+                const std::size_t j = edge_begin[e][1];
+                std::size_t c_i, c_j;
+#ifdef LP_MP_PARALLEL
+#pragma omp atomic capture
+#endif
+                c_i = adjacency_list_count[i]++;
+#ifdef LP_MP_PARALLEL
+#pragma omp atomic capture
+#endif
+                c_j = adjacency_list_count[j]++;
+
+                auto& e_ij = edges_(i, c_i);
+                e_ij.head_ = j;
+                e_ij.sister_ = edge_number_to_pointer(e);
+                e_ij.edge() = f(edge_begin[e]);
+
+                auto& e_ji = edges_(j, c_j);
+                e_ji.head_ = i;
+                e_ji.sister_ = edge_number_to_pointer(e);
+                e_ji.edge() = f(edge_begin[e]);
+            }
+
+#pragma omp parallel for schedule(guided)
+			for(std::size_t i=0; i<no_nodes; ++i) {
+				std::sort(edges_[i].begin(), edges_[i].end());
 			}
-        }
+
+            // match sisters through edge numbers: first record the half edge pointing to the larger node, then link the other half edge to it.
+            std::vector<edge_type*> upward_edge(no_edges);
+#pragma omp parallel for schedule(guided)
+            for(std::size_t i=0; i<no_nodes; ++i) {
+                for(auto edge_it=edges_[i].begin(); edge_it!=edges_[i].end(); ++edge_it) {
+                    if(edge_it->head() > i) {
+                        upward_edge[pointer_to_edge_number(edge_it->sister_)] = &(*edge_it);
+                    }
+                }
+            }
+#pragma omp parallel for schedule(guided)
+            for(std::size_t j=0; j<no_nodes; ++j) {
+                for(auto edge_it=edges_[j].begin(); edge_it!=edges_[j].end(); ++edge_it) {
+                    if(edge_it->head() < j) {
+                        auto* sister = upward_edge[pointer_to_edge_number(edge_it->sister_)];
+                        edge_it->sister_ = sister;
+                        sister->sister_ = &(*edge_it);
+                    }
+                }
+            }
+		}
+        public:
 
         // TODO: implement move operator
         graph& operator=(const graph& o)
@@ -472,7 +583,7 @@ namespace LP_MP {
                     for(auto a_it=g.begin(i); a_it!=g.end(i); ++a_it) { 
                         const std::size_t j = a_it->head();
 
-                        if(mask_op(i,j,*a_it)) {
+                        if(mask_op(i,j,a_it->edge())) {
 
                             if(!labelled(j)) {
                                 visit.push_back({j, distance+1});
@@ -512,6 +623,56 @@ namespace LP_MP {
             return std::vector<std::size_t>({});
         }
 
+        // single source bfs from start_node until all end nodes are reached, so that queries with common start node share exploration.
+        // Returns for each end node a shortest path from start_node to it, empty if not reachable.
+        template<typename END_NODE_ITERATOR, typename MASK_OP>
+        std::vector<std::vector<std::size_t>> find_paths(const std::size_t start_node, END_NODE_ITERATOR end_node_begin, END_NODE_ITERATOR end_node_end, MASK_OP mask_op)
+        {
+            assert(start_node < g.no_nodes());
+            reset();
+            // unreached end nodes carry label 2
+            std::size_t no_unreached = 0;
+            for(auto it=end_node_begin; it!=end_node_end; ++it) {
+                assert(*it < g.no_nodes() && *it != start_node);
+                if(!labelled2(*it)) {
+                    label2(*it);
+                    ++no_unreached;
+                }
+            }
+            visit.push_back({start_node, 0});
+            label1(start_node);
+            parent(start_node) = start_node;
+
+            while(!visit.empty() && no_unreached > 0) {
+                const std::size_t i = visit.front()[0];
+                const std::size_t distance = visit.front()[1];
+                visit.pop_front();
+
+                for(auto a_it=g.begin(i); a_it!=g.end(i); ++a_it) { 
+                    const std::size_t j = a_it->head();
+                    if(!labelled1(j) && mask_op(i,j,a_it->edge())) {
+                        if(labelled2(j)) { --no_unreached; }
+                        visit.push_back({j, distance+1});
+                        d[j].e = a_it->edge();
+                        parent(j) = i;
+                        label1(j);
+                    }
+                }
+            }
+
+            std::vector<std::vector<std::size_t>> paths;
+            paths.reserve(std::distance(end_node_begin, end_node_end));
+            for(auto it=end_node_begin; it!=end_node_end; ++it) {
+                paths.push_back({});
+                if(!labelled1(*it)) { continue; }
+                auto& path = paths.back();
+                for(std::size_t j=*it; j!=start_node; j=parent(j)) { path.push_back(j); }
+                path.push_back(start_node);
+                std::reverse(path.begin(), path.end());
+            }
+            return paths;
+        }
+
         private:
         std::vector<item> d;
         std::deque<std::array<std::size_t,2>> visit; // node number, distance from start or end 
@@ -519,6 +680,50 @@ namespace LP_MP {
         const GRAPH& g;
     };
 
+    // find shortest paths for many (start node, end node) queries concurrently on the read-only graph, each thread with its own bfs_data.
+    // Queries with the same start node are answered by one single source bfs, so that all returned paths are shortest ones. Paths go from start to end node and are empty if no path exists.
+    // mask_op is called concurrently and must be thread safe.
+    template<typename GRAPH, typename QUERY_ITERATOR, typename MASK_OP>
+    std::vector<std::vector<std::size_t>> find_paths(const GRAPH& g, QUERY_ITERATOR query_begin, QUERY_ITERATOR query_end, MASK_OP mask_op)
+    {
+        const std::size_t no_queries = std::distance(query_begin, query_end);
+        std::vector<std::array<std::size_t,2>> queries;
+        queries.reserve(no_queries);
+        for(auto it=query_begin; it!=query_end; ++it) { queries.push_back({(*it)[0], (*it)[1]}); }
+
+        // group queries by start node
+        std::vector<std::size_t> query_order(no_queries);
+        std::iota(query_order.begin(), query_order.end(), 0);
+        std::stable_sort(query_order.begin(), query_order.end(), [&](const std::size_t q1, const std::size_t q2) { return queries[q1][0] < queries[q2][0]; });
+        std::vector<std::size_t> group_begin;
+        for(std::size_t k=0; k<no_queries; ++k) {
+            if(k == 0 || queries[query_order[k]][0] != queries[query_order[k-1]][0]) { group_begin.push_back(k); }
+        }
+        group_begin.push_back(no_queries);
+
+        std::vector<std::vector<std::size_t>> paths(no_queries);
+#pragma omp parallel
+        {
+            bfs_data<GRAPH> bfs(g);
+            std::vector<std::size_t> end_nodes;
+#pragma omp for schedule(dynamic)
+            for(std::size_t c=0; c<group_begin.size()-1; ++c) {
+                const std::size_t start_node = queries[query_order[group_begin[c]]][0];
+                end_nodes.clear();
+                for(std::size_t k=group_begin[c]; k<group_begin[c+1]; ++k) { end_nodes.push_back(queries[query_order[k]][1]); }
+                auto group_paths = bfs.find_paths(start_node, end_nodes.begin(), end_nodes.end(), mask_op);
+                for(std::size_t k=group_begin[c]; k<group_begin[c+1]; ++k) { paths[query_order[k]] = std::move(group_paths[k-group_begin[c]]); }
+            }
+        }
+        return paths;
+    }
+
+    template<typename GRAPH, typename QUERY_ITERATOR>
+    std::vector<std::vector<std::size_t>> find_paths(const GRAPH& g, QUERY_ITERATOR query_begin, QUERY_ITERATOR query_end)
+    {
+        return find_paths(g, query_begin, query_end, bfs_data<GRAPH>::no_mask_op);
+    }
+
 } // namespace LP_MP
 
 #endif // LP_MP_CUT_PACKING_HXX
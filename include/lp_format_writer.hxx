@@ -0,0 +1,352 @@
+#ifndef LP_MP_LP_FORMAT_WRITER_HXX
+#define LP_MP_LP_FORMAT_WRITER_HXX
+
+#include "config.hxx"
+#include <ostream>
+#include <vector>
+#include <array>
+#include <iterator>
+#include <limits>
+#include <cmath>
+#include <cassert>
+#include <stdexcept>
+
+// streaming writer for the CPLEX LP file format. It implements the subset of the DD_ILP::external_solver_interface used by construct_constraints and load_costs of factors and messages,
+// but instead of holding the model in memory, rows are written to the output stream as soon as they are constructed.
+// Only the shapes of variable groups (one entry per vector/matrix/tensor) are stored, such that construct_constraints can be replayed with identical variable indices.
+// The file is written in passes, driven by LP_external_solver::write_lp_file:
+//   objective:   construct_constraints of every factor with rows suppressed, followed by load_costs, writing the objective. Messages are constructed with rows suppressed as well, recording their auxiliary variables.
+//   constraints: construct_constraints of every factor and message, replaying variable indices, writing rows. Chunks of factors resp. messages can be written in parallel.
+//   bounds:      load_costs again, fixing variables with infinite cost to zero.
+
+namespace LP_MP {
+
+class lp_format_writer {
+public:
+   using variable = INDEX;
+
+   struct variable_counters {
+      std::size_t variable = 0;
+      std::size_t vector = 0;
+      std::size_t matrix = 0;
+      std::size_t tensor = 0;
+   };
+
+   class variable_iterator {
+   public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = variable;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const variable*;
+      using reference = variable;
+
+      variable_iterator(const variable v = 0) : v_(v) {}
+      variable operator*() const { return v_; }
+      variable operator[](const difference_type i) const { return v_ + i; }
+      variable_iterator& operator++() { ++v_; return *this; }
+      variable_iterator operator++(int) { auto it = *this; ++v_; return it; }
+      variable_iterator& operator--() { --v_; return *this; }
+      variable_iterator operator--(int) { auto it = *this; --v_; return it; }
+      variable_iterator& operator+=(const difference_type i) { v_ += i; return *this; }
+      variable_iterator& operator-=(const difference_type i) { v_ -= i; return *this; }
+      variable_iterator operator+(const difference_type i) const { return variable_iterator(v_ + i); }
+      variable_iterator operator-(const difference_type i) const { return variable_iterator(v_ - i); }
+      difference_type operator-(const variable_iterator o) const { return difference_type(v_) - difference_type(o.v_); }
+      bool operator==(const variable_iterator o) const { return v_ == o.v_; }
+      bool operator!=(const variable_iterator o) const { return v_ != o.v_; }
+      bool operator<(const variable_iterator o) const { return v_ < o.v_; }
+   private:
+      variable v_;
+   };
+
+   class vector {
+   public:
+      vector(const variable begin = 0, const INDEX size = 0) : begin_(begin), size_(size) {}
+      variable operator[](const INDEX i) const { assert(i < size_); return begin_ + i; }
+      INDEX size() const { return size_; }
+      variable_iterator begin() const { return variable_iterator(begin_); }
+      variable_iterator end() const { return variable_iterator(begin_ + size_); }
+   private:
+      variable begin_;
+      INDEX size_;
+   };
+
+   class matrix {
+   public:
+      matrix(const variable begin = 0, const INDEX dim1 = 0, const INDEX dim2 = 0) : begin_(begin), dim_({dim1, dim2}) {}
+      variable operator()(const INDEX i, const INDEX j) const { assert(i < dim_[0] && j < dim_[1]); return begin_ + i*dim_[1] + j; }
+      variable operator[](const INDEX i) const { assert(i < size()); return begin_ + i; }
+      INDEX dim(const INDEX d) const { assert(d < 2); return dim_[d]; }
+      INDEX size() const { return dim_[0]*dim_[1]; }
+      variable_iterator begin() const { return variable_iterator(begin_); }
+      variable_iterator end() const { return variable_iterator(begin_ + size()); }
+   private:
+      variable begin_;
+      std::array<INDEX,2> dim_;
+   };
+
+   class tensor {
+   public:
+      tensor(const variable begin = 0, const INDEX dim1 = 0, const INDEX dim2 = 0, const INDEX dim3 = 0) : begin_(begin), dim_({dim1, dim2, dim3}) {}
+      variable operator()(const INDEX i, const INDEX j, const INDEX k) const { assert(i < dim_[0] && j < dim_[1] && k < dim_[2]); return begin_ + (i*dim_[1] + j)*dim_[2] + k; }
+      variable operator[](const INDEX i) const { assert(i < size()); return begin_ + i; }
+      INDEX dim(const INDEX d) const { assert(d < 3); return dim_[d]; }
+      INDEX size() const { return dim_[0]*dim_[1]*dim_[2]; }
+      variable_iterator begin() const { return variable_iterator(begin_); }
+      variable_iterator end() const { return variable_iterator(begin_ + size()); }
+   private:
+      variable begin_;
+      std::array<INDEX,3> dim_;
+   };
+
+   lp_format_writer(std::ostream& out) : out_(out)
+   {
+      out_.precision(std::numeric_limits<REAL>::max_digits10);
+   }
+   lp_format_writer(const lp_format_writer&) = delete;
+
+   // writer for the rows of a consecutive chunk of factors or messages, starting at the given variable counters.
+   // Chunks share the variables recorded by this writer read-only, hence they can be written concurrently into separate buffers.
+   // Rows are named after the chunk, such that the output does not depend on the order in which chunks are written.
+   lp_format_writer chunk(std::ostream& out, const variable_counters& start, const std::size_t chunk_no) const
+   {
+      assert(pass_ == pass::constraints);
+      return lp_format_writer(*this, out, start, chunk_no);
+   }
+
+   // passes
+   void begin_objective()
+   {
+      pass_ = pass::objective;
+      out_ << "Minimize\n obj:";
+      terms_on_line_ = 0;
+   }
+
+   void begin_constraints()
+   {
+      pass_ = pass::constraints;
+      add_counters_ = variable_counters();
+      out_ << "\nSubject To\n";
+   }
+
+   void begin_bounds()
+   {
+      pass_ = pass::bounds;
+      init_variable_loading();
+      out_ << "Bounds\n";
+   }
+
+   // all variables are binary, as in DD_ILP
+   void end()
+   {
+      out_ << "Binary\n";
+      for(variable v=0; v<shapes_->no_variables; ++v) {
+         out_ << " x" << v;
+         if(v % 16 == 15 || v+1 == shapes_->no_variables) { out_ << "\n"; }
+      }
+      out_ << "End\n";
+   }
+
+   std::size_t no_variables() const { return shapes_->no_variables; }
+   std::size_t no_constraints() const { return no_constraints_; }
+
+   // variable creation and loading, mirroring DD_ILP::external_solver_interface
+   variable_counters get_variable_counters() const { return add_counters_; }
+   void set_variable_counters(const variable_counters& c) { load_counters_ = c; }
+   void init_variable_loading() { load_counters_ = variable_counters(); }
+
+   variable add_variable()
+   {
+      if(add_counters_.variable < shapes_->variables.size()) { return shapes_->variables[add_counters_.variable++]; }
+      shapes_->variables.push_back(new_variables(1));
+      ++add_counters_.variable;
+      return shapes_->variables.back();
+   }
+
+   template<typename VECTOR>
+   vector add_vector(const VECTOR& v)
+   {
+      if(add_counters_.vector < shapes_->vectors.size()) {
+         assert(shapes_->vectors[add_counters_.vector].size() == v.size());
+         return shapes_->vectors[add_counters_.vector++];
+      }
+      shapes_->vectors.push_back(vector(new_variables(v.size()), v.size()));
+      ++add_counters_.vector;
+      return shapes_->vectors.back();
+   }
+
+   template<typename MATRIX>
+   matrix add_matrix(const MATRIX& m)
+   {
+      if(add_counters_.matrix < shapes_->matrices.size()) {
+         assert(shapes_->matrices[add_counters_.matrix].dim(0) == m.dim1() && shapes_->matrices[add_counters_.matrix].dim(1) == m.dim2());
+         return shapes_->matrices[add_counters_.matrix++];
+      }
+      shapes_->matrices.push_back(matrix(new_variables(m.dim1()*m.dim2()), m.dim1(), m.dim2()));
+      ++add_counters_.matrix;
+      return shapes_->matrices.back();
+   }
+
+   template<typename TENSOR>
+   tensor add_tensor(const TENSOR& t)
+   {
+      if(add_counters_.tensor < shapes_->tensors.size()) {
+         assert(shapes_->tensors[add_counters_.tensor].dim(0) == t.dim1() && shapes_->tensors[add_counters_.tensor].dim(1) == t.dim2() && shapes_->tensors[add_counters_.tensor].dim(2) == t.dim3());
+         return shapes_->tensors[add_counters_.tensor++];
+      }
+      shapes_->tensors.push_back(tensor(new_variables(t.dim1()*t.dim2()*t.dim3()), t.dim1(), t.dim2(), t.dim3()));
+      ++add_counters_.tensor;
+      return shapes_->tensors.back();
+   }
+
+   variable load_variable() { assert(load_counters_.variable < shapes_->variables.size()); return shapes_->variables[load_counters_.variable++]; }
+   vector load_vector() { assert(load_counters_.vector < shapes_->vectors.size()); return shapes_->vectors[load_counters_.vector++]; }
+   matrix load_matrix() { assert(load_counters_.matrix < shapes_->matrices.size()); return shapes_->matrices[load_counters_.matrix++]; }
+   tensor load_tensor() { assert(load_counters_.tensor < shapes_->tensors.size()); return shapes_->tensors[load_counters_.tensor++]; }
+
+   // costs are written in the objective pass and turned into bounds in the bounds pass
+   void add_variable_objective(const REAL cost) { add_objective(load_variable(), cost); }
+
+   template<typename VECTOR>
+   void add_vector_objective(const VECTOR& cost)
+   {
+      const auto v = load_vector();
+      assert(v.size() == cost.size());
+      for(INDEX i=0; i<v.size(); ++i) { add_objective(v[i], cost[i]); }
+   }
+
+   template<typename MATRIX>
+   void add_matrix_objective(const MATRIX& cost)
+   {
+      const auto m = load_matrix();
+      for(INDEX i=0; i<m.dim(0); ++i) {
+         for(INDEX j=0; j<m.dim(1); ++j) {
+            add_objective(m(i,j), cost(i,j));
+         }
+      }
+   }
+
+   template<typename TENSOR>
+   void add_tensor_objective(const TENSOR& cost)
+   {
+      const auto t = load_tensor();
+      for(INDEX i=0; i<t.dim(0); ++i) {
+         for(INDEX j=0; j<t.dim(1); ++j) {
+            for(INDEX k=0; k<t.dim(2); ++k) {
+               add_objective(t(i,j,k), cost(i,j,k));
+            }
+         }
+      }
+   }
+
+   // constraints
+   template<typename ITERATOR>
+   void add_simplex_constraint(ITERATOR begin, ITERATOR end)
+   {
+      if(pass_ != pass::constraints) { return; }
+      begin_row();
+      for(; begin!=end; ++begin) { write_term(1.0, *begin); }
+      out_ << " = 1\n";
+   }
+
+   // returns a variable which is one iff one of the given variables is one
+   template<typename ITERATOR>
+   variable add_at_most_one_constraint(ITERATOR begin, ITERATOR end)
+   {
+      const variable one_active = add_variable();
+      if(pass_ != pass::constraints) { return one_active; }
+      begin_row();
+      for(; begin!=end; ++begin) { write_term(1.0, *begin); }
+      write_term(-1.0, one_active);
+      out_ << " = 0\n";
+      return one_active;
+   }
+
+   void make_equal(const variable a, const variable b)
+   {
+      if(pass_ != pass::constraints) { return; }
+      begin_row();
+      write_term(1.0, a);
+      write_term(-1.0, b);
+      out_ << " = 0\n";
+   }
+
+   template<typename ITERATOR>
+   void make_equal(ITERATOR begin_1, ITERATOR end_1, ITERATOR begin_2, ITERATOR end_2)
+   {
+      assert(std::distance(begin_1, end_1) == std::distance(begin_2, end_2));
+      for(; begin_1!=end_1; ++begin_1, ++begin_2) { make_equal(*begin_1, *begin_2); }
+   }
+
+private:
+   enum class pass {objective, constraints, bounds};
+
+   struct variable_shapes {
+      std::size_t no_variables = 0;
+      std::vector<variable> variables;
+      std::vector<vector> vectors;
+      std::vector<matrix> matrices;
+      std::vector<tensor> tensors;
+   };
+
+   lp_format_writer(const lp_format_writer& parent, std::ostream& out, const variable_counters& start, const std::size_t chunk_no)
+      : out_(out), pass_(parent.pass_), add_counters_(start), shapes_(parent.shapes_), chunk_no_(chunk_no)
+   {
+      out_.precision(std::numeric_limits<REAL>::max_digits10);
+   }
+
+   variable new_variables(const std::size_t n)
+   {
+      if(shapes_ != &own_shapes_) {
+         throw std::runtime_error("lp_format_writer: variables of a chunk must have been recorded before writing its rows.");
+      }
+      const variable first = shapes_->no_variables;
+      shapes_->no_variables += n;
+      return first;
+   }
+
+   void add_objective(const variable v, const REAL cost)
+   {
+      if(pass_ == pass::objective) {
+         if(cost == 0.0 || !std::isfinite(cost)) { return; }
+         write_term(cost, v);
+      } else if(pass_ == pass::bounds) {
+         if(std::isfinite(cost)) { return; }
+         assert(cost > 0.0);
+         out_ << " x" << v << " = 0\n";
+      }
+   }
+
+   void begin_row()
+   {
+      out_ << " c";
+      if(chunk_no_ != std::numeric_limits<std::size_t>::max()) { out_ << chunk_no_ << "_"; }
+      out_ << no_constraints_++ << ":";
+      terms_on_line_ = 0;
+   }
+
+   // LP readers limit the line length, hence long sums are continued on the next line
+   void write_term(const REAL coeff, const variable v)
+   {
+      if(terms_on_line_ == 8) { out_ << "\n   "; terms_on_line_ = 0; }
+      ++terms_on_line_;
+      if(coeff < 0.0) { out_ << " - " << -coeff; }
+      else { out_ << " + " << coeff; }
+      out_ << " x" << v;
+   }
+
+   std::ostream& out_;
+   pass pass_ = pass::objective;
+   std::size_t no_constraints_ = 0;
+   INDEX terms_on_line_ = 0;
+
+   variable_counters add_counters_;
+   variable_counters load_counters_;
+   variable_shapes own_shapes_;
+   variable_shapes* shapes_ = &own_shapes_;
+   std::size_t chunk_no_ = std::numeric_limits<std::size_t>::max();
+};
+
+} // namespace LP_MP
+
+#endif // LP_MP_LP_FORMAT_WRITER_HXX
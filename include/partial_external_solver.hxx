@@ -4,12 +4,21 @@
 #include "DD_ILP.hxx"
 #include "LP_MP.h"
 #include "external_solver_interface.hxx"
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
 
 namespace LP_MP {
 
 // This class mimics an `LP_MP::LP` but does not inherit from it. This allows
 // reusing the very same factors and messages and computing their primal values
 // with an external solver.
+//
+// The subproblem is built up incrementally: the external solver is kept
+// between calls to `solve`, constraints of factors and messages are added
+// once, and costs are only loaded for new factors and factors whose
+// reparametrization was changed (see `costs_changed`).
 template<typename EXTERNAL_SOLVER>
 class partial_external_solver {
 public:
@@ -23,9 +32,18 @@ public:
 
       external_variable_counter_.push_back(s_.get_variable_counters());
       f->construct_constraints(s_);
+      stale_costs_.push_back(f_.size()-1);
     }
   }
 
+  // Reparametrization of f has changed, its costs are reloaded in the next
+  // call to `solve`.
+  void costs_changed(FactorTypeAdapter* f) {
+    auto it = factor_address_to_index_.find(f);
+    assert(it != factor_address_to_index_.end());
+    stale_costs_.push_back(it->second);
+  }
+
   template<typename MESSAGE_CONTAINER_TYPE>
   void add_message(MESSAGE_CONTAINER_TYPE* m) {
     if (!has_message(m)) {
@@ -36,6 +54,7 @@ public:
       auto li = factor_address_to_index_[l];
       auto ri = factor_address_to_index_[r];
       m->construct_constraints(s_, external_variable_counter_[li], external_variable_counter_[ri]);
+      m_.insert(m);
     }
   }
 
@@ -51,20 +70,18 @@ public:
     return factor_address_to_index_.find(f) != factor_address_to_index_.end();
   }
 
-  bool has_message(AbstractMessageContainer* m) {
+  bool has_message(const void* m) {
     return m_.find(m) != m_.end();
   }
 
   INDEX GetNumberOfFactors() const { return f_.size(); }
-  INDEX GetNumberOfMessages() const { return f_.size(); }
+  INDEX GetNumberOfMessages() const { return m_.size(); }
 
   bool solve() {
     bool result = true;
 
     if (dirty_) {
-      s_.init_variable_loading();
-      for (auto* f : f_)
-        f->load_costs(s_);
+      load_stale_costs();
       result = s_.solve();
 
       s_.init_variable_loading();
@@ -87,12 +104,25 @@ public:
   bool dirty () const { return dirty_; }
 
 private:
+  void load_stale_costs() {
+    std::sort(stale_costs_.begin(), stale_costs_.end());
+    stale_costs_.erase(std::unique(stale_costs_.begin(), stale_costs_.end()), stale_costs_.end());
+
+    s_.init_variable_loading();
+    for (auto i : stale_costs_) {
+      s_.set_variable_counters(external_variable_counter_[i]);
+      f_[i]->load_costs(s_);
+    }
+    stale_costs_.clear();
+  }
+
   DD_ILP::external_solver_interface<EXTERNAL_SOLVER> s_;
   std::vector<FactorTypeAdapter*> f_;
-  std::unordered_set<AbstractMessageContainer*> m_;
+  std::unordered_set<const void*> m_; // messages have no common base class
   std::unordered_map<FactorTypeAdapter*, INDEX> factor_address_to_index_;
   std::vector<typename DD_ILP::variable_counters> external_variable_counter_;
-  bool dirty_;
+  std::vector<INDEX> stale_costs_; // factors whose costs have not been loaded since they were added or changed
+  bool dirty_ = false;
 };
 
 } // end namespace LP_MP
@@ -217,6 +217,8 @@ public:
 
   char* begin() { return archive_; }
   char* end() { return end_; }
+  const char* begin() const { return archive_; }
+  const char* end() const { return end_; }
 
 private:
   char* archive_ = nullptr;
@@ -532,9 +534,11 @@ public:
      void serialize(T* pointer, const INDEX size)
      {
        static_assert(std::is_same<T,float>::value || std::is_same<T,double>::value,"");
-       T* val = (T*) ar.cur_address();
+       const T* const val = (T*) ar.cur_address();
+       const T scaling = T(scaling_);
+#pragma omp simd
        for(INDEX i=0; i<size; ++i) {
-         pointer[i] += T(scaling_) * val[i]; 
+         pointer[i] += scaling * val[i]; 
        }
        const INDEX size_in_bytes = sizeof(T)*size;
        ar.advance(size_in_bytes);
@@ -621,6 +625,97 @@ private:
   const REAL scaling_;
 };
 
+// determines whether dual variables are stored as one contiguous array of REAL, so that they can be accessed directly instead of through an archive
+class dual_span_archive {
+public:
+   // for arrays
+   template<typename T>
+     void serialize(T* pointer, const INDEX size)
+     {
+       if(!std::is_same<T,REAL>::value) {
+         contiguous_ = false;
+         return;
+       }
+       REAL* p = (REAL*) pointer;
+       if(begin_ == nullptr) {
+         begin_ = p;
+         end_ = p + size;
+       } else if(p == end_) {
+         end_ += size;
+       } else {
+         contiguous_ = false;
+       }
+     }
+   template<typename T>
+     void serialize( binary_data<T> b )
+     {
+       serialize(b.pointer, b.no_elements); 
+     }
+
+   // for std::array<T,N>
+   template<typename T, std::size_t N>
+     void serialize(std::array<T,N>& v)
+     {
+       serialize(v.data(), N);
+     } 
+
+   // for vector<T>
+   template<typename T>
+     void serialize(vector<T>& v)
+     {
+       serialize(v.begin(), v.size());
+     }
+
+   // matrices may be padded
+   template<typename T>
+     void serialize(matrix<T>& m)
+     {
+       contiguous_ = false;
+     }
+
+   // for std::vector<T>
+   template<typename T>
+     void serialize(std::vector<T>& v)
+     {
+       serialize(v.data(), v.size());
+     } 
+
+  // for std::bitset<N>
+  template<std::size_t N>
+  void serialize(const std::bitset<N>& v)
+  {
+    contiguous_ = false;
+  }
+
+   // for plain data
+   template<typename T>
+     typename std::enable_if<std::is_arithmetic<T>::value>::type
+     serialize(T& t)
+     {
+       serialize(&t, 1);
+     }
+
+   // save multiple entries
+   template<typename... T_REST>
+     void operator()(T_REST&&... types)
+     {}
+   template<typename T, typename... T_REST>
+     void operator()(T&& t, T_REST&&... types)
+     {
+       serialize(t);
+       (*this)(types...);
+     }
+
+   // nullptr if dual variables are not contiguous
+   REAL* begin() const { return contiguous_ ? begin_ : nullptr; }
+   INDEX size() const { return end_ - begin_; }
+
+private:
+  REAL* begin_ = nullptr;
+  REAL* end_ = nullptr;
+  bool contiguous_ = true;
+};
+
 } // end namespace LP_MP
 #endif // LP_MP_SERIALIZE_HXX
 
@@ -7,10 +7,17 @@
 #include <condition_variable>
 #include <fstream>
 #include <sstream>
+#include <memory>
+#include <atomic>
+#include <random>
+#include <exception>
+#include <algorithm>
 
 #include "LP_MP.h"
 #include "function_existence.hxx"
 #include "template_utilities.hxx"
+#include "checkpoint.hxx"
+#include "factor_archive.hxx"
 #include "tclap/CmdLine.h"
 
 namespace LP_MP {
@@ -58,6 +65,10 @@ private:
         inputFileArg_("i","inputFile","file from which to read problem instance",false,"","file name",cmd_),
         outputFileArg_("o","outputFile","file to write solution",false,"","file name",cmd_),
         verbosity_arg_("v","verbosity","verbosity level: 0 = silent, 1 = important runtime information, 2 = further diagnostics",false,1,"0,1,2",cmd_),
+        checkpointFileArg_("","checkpointFile","file to periodically write the solver state to",false,"","file name",cmd_),
+        checkpointToleranceArg_("","checkpointTolerance","dual changes up to this tolerance are not written to incremental checkpoints, default = 0",false,0.0,"non-negative real",cmd_),
+        checkpointFullIntervalArg_("","checkpointFullInterval","every x-th checkpoint is written in full, the others incrementally, default = 10",false,10,"positive integer",cmd_),
+        resumeFileArg_("","resumeFile","checkpoint from which to resume optimization",false,"","file name",cmd_),
         visitor_(cmd_)
    {
       for_each_tuple(this->problemConstructor_, [this](auto& l) {
@@ -65,8 +76,6 @@ private:
            l = new typename std::remove_pointer<typename std::remove_reference<decltype(l)>::type>::type(*this); // note: this is not so nice: if problem constructor needs other problem constructors, those must already be allocated, otherwise address is invalid. This is only a problem for circular references, though, otherwise order problem constructors accordingly. This should be resolved when std::tuple will be constructed without move and copy constructors.
            assert(l != nullptr);
       }); 
-
-      std::cout << std::setprecision(10);
    }
 
 public:
@@ -123,6 +132,13 @@ public:
    } 
 
    void WritePrimal()
+   {
+      if(outputFileArg_.isSet()) {
+         WritePrimal(best_primal_string());
+      }
+   }
+
+   void WritePrimal(const std::string& solution)
    {
       if(outputFileArg_.isSet()) {
          std::ofstream output_file;
@@ -131,7 +147,7 @@ public:
             throw std::runtime_error("could not open file " + outputFile_);
          }
          
-         output_file << solution_; // to do: not so nice, better have primal serialized, write back into factors, then write primal?
+         output_file << solution;
 
          //for_each_tuple(this->problemConstructor_, [this,&output_file](auto* l) {
          //      using pc_type = typename std::remove_pointer<decltype(l)>::type;
@@ -157,6 +173,17 @@ public:
       return std::move(sol);
    }
 
+   // textual form of the best primal solution found so far. The binary snapshot is written into the factors for the problem constructors to read, afterwards the current primal is restored
+   std::string best_primal_string()
+   {
+      if(best_primal_.empty()) { return ""; }
+      factor_archive<serialization_functor::primal> current(lp_);
+      best_primal_.load();
+      std::string sol = write_primal_into_string();
+      current.load();
+      return sol;
+   }
+
    LP_MP_FUNCTION_EXISTENCE_CLASS(HasCheckPrimalConsistency,CheckPrimalConsistency)
    // invoke the corresponding functions of problem constructors
    template<typename PROBLEM_CONSTRUCTOR>
@@ -229,18 +256,38 @@ public:
    
    int Solve()
    {
+      verbosity = verbosity_arg_.getValue(); // the solver may run on another thread than the one it was constructed on
       if(debug()) {
          std::cout << "lower bound before optimization = " << lp_.LowerBound() << "\n";
       }
 
       this->Begin();
       LpControl c = visitor_.begin(this->lp_);
+      if(resumeFileArg_.isSet()) {
+         load_checkpoint(resumeFileArg_.getValue());
+      }
+      std::unique_ptr<checkpoint::background_writer> checkpoint_writer;
+      bool checkpoint_pending = false;
+      if(checkpointFileArg_.isSet()) {
+         checkpoint_writer = std::make_unique<checkpoint::background_writer>(checkpointFileArg_.getValue(), checkpointToleranceArg_.getValue(), checkpointFullIntervalArg_.getValue());
+      }
       while(!c.end && !c.error) {
          this->PreIterate(c);
          this->Iterate(c);
          this->PostIterate(c);
          c = visitor_.visit(c, this->lowerBound_, this->bestPrimalCost_);
          ++iter;
+         // checkpoints requested while the previous one is still being written are deferred instead of waiting for it
+         if((c.checkpoint || checkpoint_pending) && checkpoint_writer) {
+            checkpoint_pending = !checkpoint_writer->submit(lp_, best_primal_, [this](auto& ar) { serialize_state(ar); });
+         }
+      }
+      if(checkpoint_writer) {
+         checkpoint_writer->finish();
+         if(checkpoint_pending) {
+            checkpoint_writer->submit(lp_, best_primal_, [this](auto& ar) { serialize_state(ar); });
+            checkpoint_writer->finish();
+         }
       }
       if(!c.error) {
          this->End();
@@ -248,10 +295,14 @@ public:
          lowerBound_ = lp_.LowerBound();
          // possibly primal has been computed in end. Call visitor again
          visitor_.end(this->lowerBound_, this->bestPrimalCost_);
-         if constexpr(visitor_has_solution()) {
-               this->visitor_.solution(this->solution_);
+         // the textual solution is only produced once here
+         if(visitor_has_solution() || outputFileArg_.isSet()) {
+            const std::string solution = best_primal_string();
+            if constexpr(visitor_has_solution()) {
+               this->visitor_.solution(solution);
+            }
+            this->WritePrimal(solution);
          }
-         this->WritePrimal();
       }
       return !c.error;
    }
@@ -313,7 +364,7 @@ public:
       if(cost < bestPrimalCost_) {
          // assume solution is feasible
          bestPrimalCost_ = cost;
-         solution_ = write_primal_into_string();
+         best_primal_.save(lp_);
       }
    }
 
@@ -330,7 +381,7 @@ public:
                std::cout << "solution feasible\n";
             }
             bestPrimalCost_ = cost;
-            solution_ = write_primal_into_string();
+            best_primal_.save(lp_);
          } else {
             if(debug()) {
                std::cout << "solution infeasible\n";
@@ -339,6 +390,25 @@ public:
       }
    }
 
+   LP_MP_FUNCTION_EXISTENCE_CLASS(has_serialize_state,serialize_state)
+   constexpr static bool
+   visitor_has_serialize_state()
+   {
+      return has_serialize_state<VISITOR, void, save_archive&>();
+   }
+
+   // write dual and primal of all factors together with iteration, bounds, best primal solution and visitor state, see checkpoint.hxx
+   void save_checkpoint(const std::string& filename)
+   {
+      checkpoint::write(filename, lp_, best_primal_, [this](auto& ar) { serialize_state(ar); });
+   }
+
+   // the model must have been constructed identically to the one the checkpoint was written for
+   void load_checkpoint(const std::string& filename)
+   {
+      checkpoint::read(filename, lp_, best_primal_, [this](auto& ar) { serialize_state(ar); });
+   }
+
    REAL lower_bound() const { return lowerBound_; }
    REAL primal_cost() const { return bestPrimalCost_; }
 
@@ -367,14 +437,30 @@ protected:
    std::string outputFile_;
 
    TCLAP::ValueArg<INDEX> verbosity_arg_;
+   TCLAP::ValueArg<std::string> checkpointFileArg_;
+   TCLAP::ValueArg<REAL> checkpointToleranceArg_;
+   TCLAP::ValueArg<INDEX> checkpointFullIntervalArg_;
+   TCLAP::ValueArg<std::string> resumeFileArg_;
 
-   REAL lowerBound_;
+   REAL lowerBound_ = -std::numeric_limits<REAL>::infinity();
    // while Solver does not know how to compute primal, derived solvers do know. After computing a primal, they are expected to register their primals with the base solver
    REAL bestPrimalCost_ = std::numeric_limits<REAL>::infinity();
-   std::string solution_;
+   // binary snapshot of the primal of all factors at bestPrimalCost_, textual output is produced from it only on demand
+   factor_archive<serialization_functor::primal> best_primal_;
 
    VISITOR visitor_;
    INDEX iter = 0;
+
+private:
+   // the best primal solution is stored as its own checkpoint section, see checkpoint.hxx
+   template<typename ARCHIVE>
+   void serialize_state(ARCHIVE& ar)
+   {
+      ar(iter, lowerBound_, bestPrimalCost_);
+      if constexpr(visitor_has_serialize_state()) {
+         visitor_.serialize_state(ar);
+      }
+   }
 };
 
 // local rounding interleaved with message passing 
@@ -480,6 +566,189 @@ private:
    Direction cur_primal_computation_direction_ = Direction::forward; 
 };
 
+enum class rounding_strategy { forward_mp, backward_mp, forward_mp_uniform, backward_mp_uniform, random_order_mp, problem_constructor };
+
+// rounding by a portfolio of strategies running concurrently to message passing.
+// When primal computation is due and no rounding is running, the dual of all factors is snapshotted and every message passing strategy is started in its own thread on a copy of the model reparametrized by the snapshot.
+// Message passing continues in the meantime. When all strategies have finished, the best primal is loaded into the factors and registered.
+// Problem constructors refer to the factors of the solved LP and cannot round on copies. Their rounding must be added to the portfolio explicitly and runs on the main thread when results are registered.
+template<typename SOLVER>
+class PortfolioRoundingSolver : public SOLVER
+{
+public:
+   using SOLVER::SOLVER;
+   using FMC = typename SOLVER::FMC;
+
+   ~PortfolioRoundingSolver()
+   {
+      for(auto& t : threads_) { t.join(); }
+   }
+
+   void set_rounding_portfolio(const std::vector<rounding_strategy>& portfolio)
+   {
+      assert(!rounding_);
+      portfolio_ = portfolio;
+      workers_.clear();
+   }
+
+   virtual void PostIterate(LpControl c)
+   {
+      if(rounding_ && no_running_ == 0) {
+         register_rounding();
+      }
+      if(c.computePrimal && !rounding_) {
+         start_rounding(c);
+      }
+      SOLVER::PostIterate(c);
+   }
+
+   virtual void End()
+   {
+      if(rounding_) {
+         register_rounding();
+      }
+      SOLVER::End();
+      this->RegisterPrimal();
+   }
+
+private:
+   LP_MP_FUNCTION_EXISTENCE_CLASS(HasComputePrimal,ComputePrimal)
+   template<typename PROBLEM_CONSTRUCTOR>
+   constexpr static bool
+   CanComputePrimal()
+   {
+      return HasComputePrimal<PROBLEM_CONSTRUCTOR, void>();
+   }
+
+   // copy of the model on which one message passing strategy rounds
+   struct rounding_worker {
+      rounding_worker(const rounding_strategy s, const INDEX seed) : cmd("portfolio rounding"), lp(cmd), strategy(s), gen(seed) {}
+      TCLAP::CmdLine cmd; // never parsed, the copy uses default options
+      LP<FMC> lp;
+      const rounding_strategy strategy;
+      std::mt19937 gen;
+      INDEX timestamp = 0; // primal is recomputed for timestamps that were not used before
+      factor_archive<serialization_functor::primal> primal;
+      REAL primal_cost = std::numeric_limits<REAL>::infinity();
+      std::exception_ptr error;
+   };
+
+   // copies are reused as long as no factors or messages are added
+   void copy_model()
+   {
+      if(!workers_.empty() && workers_.front()->lp.GetNumberOfFactors() == this->lp_.GetNumberOfFactors() && workers_.front()->lp.GetNumberOfMessages() == this->lp_.GetNumberOfMessages()) {
+         return;
+      }
+      workers_.clear();
+      for(const rounding_strategy s : portfolio_) {
+         if(s != rounding_strategy::problem_constructor) {
+            workers_.push_back(std::make_unique<rounding_worker>(s, workers_.size()));
+            workers_.back()->lp.copy_model(this->lp_);
+         }
+      }
+      dual_offsets_ = factor_offsets(this->lp_, serialization_functor::dual{});
+      primal_offsets_ = factor_offsets(this->lp_, serialization_functor::primal{});
+   }
+
+   void start_rounding(LpControl c)
+   {
+      copy_model();
+      dual_snapshot_.save(this->lp_);
+      rounding_ = true;
+      no_running_ = workers_.size();
+      for(auto& w : workers_) {
+         threads_.emplace_back([this,worker=w.get(),repam=c.repam,v=INDEX(verbosity)]() {
+               verbosity = v;
+               round(*worker, repam);
+         });
+      }
+   }
+
+   // runs in the worker thread, only reads the snapshot, which is not changed until all workers have finished
+   void round(rounding_worker& w, const LPReparametrizationMode repam)
+   {
+      try {
+         const auto& snapshot = dual_snapshot_;
+         serialize_factors<load_archive>(w.lp, snapshot.data(), dual_offsets_, serialization_functor::dual{});
+         const INDEX timestamp = w.timestamp++;
+         switch(w.strategy) {
+            case rounding_strategy::forward_mp:
+               w.lp.set_reparametrization(repam);
+               w.lp.ComputeForwardPassAndPrimal(timestamp);
+               break;
+            case rounding_strategy::backward_mp:
+               w.lp.set_reparametrization(repam);
+               w.lp.ComputeBackwardPassAndPrimal(timestamp);
+               break;
+            case rounding_strategy::forward_mp_uniform:
+               w.lp.set_reparametrization(LPReparametrizationMode::Uniform);
+               w.lp.ComputeForwardPassAndPrimal(timestamp);
+               break;
+            case rounding_strategy::backward_mp_uniform:
+               w.lp.set_reparametrization(LPReparametrizationMode::Uniform);
+               w.lp.ComputeBackwardPassAndPrimal(timestamp);
+               break;
+            case rounding_strategy::random_order_mp:
+               w.lp.ComputeRandomOrderPassAndPrimal(timestamp, w.gen);
+               break;
+            default:
+               throw std::runtime_error("rounding strategy unknown");
+         }
+         w.primal_cost = w.lp.EvaluatePrimal();
+         if(w.primal_cost < std::numeric_limits<REAL>::infinity()) {
+            w.primal.save(w.lp);
+         }
+      } catch(...) {
+         w.error = std::current_exception();
+      }
+      --no_running_;
+   }
+
+   // wait for all workers and register their primals, best one first. Primals are discarded when factors were added in the meantime.
+   void register_rounding()
+   {
+      for(auto& t : threads_) { t.join(); }
+      threads_.clear();
+      rounding_ = false;
+      for(auto& w : workers_) {
+         if(w->error) {
+            auto e = w->error;
+            w->error = nullptr;
+            std::rethrow_exception(e);
+         }
+      }
+
+      if(!workers_.empty() && workers_.front()->lp.GetNumberOfFactors() == this->lp_.GetNumberOfFactors()) {
+         std::vector<rounding_worker*> results;
+         for(auto& w : workers_) { results.push_back(w.get()); }
+         std::sort(results.begin(), results.end(), [](auto* a, auto* b) { return a->primal_cost < b->primal_cost; });
+         for(auto* w : results) {
+            if(!(w->primal_cost < this->primal_cost())) { break; }
+            serialize_factors<load_archive>(this->lp_, w->primal.data(), primal_offsets_, serialization_functor::primal{});
+            this->RegisterPrimal();
+         }
+      }
+
+      if(std::find(portfolio_.begin(), portfolio_.end(), rounding_strategy::problem_constructor) != portfolio_.end()) {
+         for_each_tuple(this->problemConstructor_, [](auto* l) {
+               using pc_type = typename std::remove_pointer<decltype(l)>::type;
+               if constexpr(PortfolioRoundingSolver<SOLVER>::CanComputePrimal<pc_type>()) {
+                  l->ComputePrimal();
+               }
+         });
+         this->RegisterPrimal();
+      }
+   }
+
+   std::vector<rounding_strategy> portfolio_ = {rounding_strategy::forward_mp, rounding_strategy::backward_mp, rounding_strategy::forward_mp_uniform, rounding_strategy::backward_mp_uniform, rounding_strategy::random_order_mp};
+   std::vector<std::unique_ptr<rounding_worker>> workers_;
+   std::vector<std::thread> threads_;
+   std::atomic<INDEX> no_running_{0};
+   bool rounding_ = false;
+   factor_archive<serialization_functor::dual> dual_snapshot_;
+   std::vector<std::size_t> dual_offsets_, primal_offsets_;
+};
+
 
 
 
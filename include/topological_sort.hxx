@@ -3,31 +3,41 @@
 
 // Compute topological sorting of a DAG
 #include <iostream>
-#include <list>
-#include <stack>
-#include <queue> 
+#include <vector>
+#include <array>
+#include <sstream>
+#include <stdexcept>
 #include <assert.h>
 #include "help_functions.hxx"
+#include "two_dimensional_variable_array.hxx"
 #include "config.hxx"
 
 namespace LP_MP {
 namespace Topological_Sort {
 
-// do zrobienia: detect, when graph is not DAG
+// Kahn's algorithm on compressed adjacency lists.
+// Nodes are processed level by level: level k contains all nodes whose longest path from a source has k edges.
+// Nodes within one level do not depend on each other and may be processed concurrently.
+// Throws if the graph is not a DAG.
 class Graph
 {
     INDEX V;    // number of vertices
-    std::vector<std::list<INDEX> > adj;
+    std::vector<std::array<INDEX,2>> edges_;
+    two_dim_variable_array<INDEX> adj;
+    two_dim_variable_array<INDEX> wavefronts_;
+    void build_adjacency_list();
+    [[noreturn]] void report_cycle(const std::vector<INDEX>& in_degree) const;
     bool sorting_valid(const std::vector<INDEX>& ordering) const;
 
 public:
-    inline Graph(INDEX V);   
+    inline Graph(INDEX V);
     inline void addEdge(INDEX v, INDEX w);
     inline std::vector<INDEX> topologicalSort();
+    // level sets computed by last call of topologicalSort
+    const two_dim_variable_array<INDEX>& wavefronts() const { return wavefronts_; }
 };
- 
+
 Graph::Graph(INDEX V)
-   : adj(V)
 {
    this->V = V;
 }
@@ -36,14 +46,27 @@ Graph::Graph(INDEX V)
 inline void Graph::addEdge(INDEX v, INDEX w)
 {
    assert(v<V && w<V);
-   adj[v].push_back(w); 
+   edges_.push_back({v,w});
+}
+
+inline void Graph::build_adjacency_list()
+{
+   std::vector<INDEX> out_degree(V,0);
+   for(const auto& e : edges_) {
+      out_degree[e[0]]++;
+   }
+   adj = two_dim_variable_array<INDEX>(uninitialized, out_degree.begin(), out_degree.end());
+   std::fill(out_degree.begin(), out_degree.end(), 0);
+   for(const auto& e : edges_) {
+      adj(e[0], out_degree[e[0]]++) = e[1];
+   }
 }
 
 inline bool Graph::sorting_valid(const std::vector<INDEX>& ordering) const
 {
   std::vector<INDEX> inverse_ordering(ordering.size());
   for(INDEX i=0; i<ordering.size(); ++i) {
-    inverse_ordering[ordering[i]] = i; 
+    inverse_ordering[ordering[i]] = i;
   }
 
    // check validity of sorting
@@ -51,97 +74,118 @@ inline bool Graph::sorting_valid(const std::vector<INDEX>& ordering) const
      for(const INDEX j : adj[i]) {
        assert(inverse_ordering[i] != inverse_ordering[j]);
        if(inverse_ordering[i] > inverse_ordering[j]) {
-         return false; 
+         return false;
        }
      }
    }
-   return true; 
+   return true;
 }
 
+// nodes with positive remaining in-degree all lie on or behind a cycle. Walk backwards along unprocessed predecessors until a node repeats.
+inline void Graph::report_cycle(const std::vector<INDEX>& in_degree) const
+{
+   const INDEX no_blocked = std::count_if(in_degree.begin(), in_degree.end(), [](const INDEX d) { return d > 0; });
+
+   std::vector<INDEX> predecessor(V, std::numeric_limits<INDEX>::max());
+   for(const auto& e : edges_) {
+      if(in_degree[e[0]] > 0 && in_degree[e[1]] > 0) {
+         predecessor[e[1]] = e[0];
+      }
+   }
+
+   INDEX v = std::find_if(in_degree.begin(), in_degree.end(), [](const INDEX d) { return d > 0; }) - in_degree.begin();
+   std::vector<INDEX> visited_at(V, std::numeric_limits<INDEX>::max());
+   std::vector<INDEX> walk;
+   while(visited_at[v] == std::numeric_limits<INDEX>::max()) {
+      assert(predecessor[v] != std::numeric_limits<INDEX>::max());
+      visited_at[v] = walk.size();
+      walk.push_back(v);
+      v = predecessor[v];
+   }
+
+   std::stringstream s;
+   s << "graph not a dag: " << no_blocked << " of " << V << " nodes cannot be ordered, cycle ";
+   for(auto it=walk.rbegin(); it!=walk.rend() - visited_at[v]; ++it) {
+      s << *it << " -> ";
+   }
+   s << walk.back();
+   throw std::runtime_error(s.str());
+}
 
 inline std::vector<INDEX> Graph::topologicalSort()
 {
   if(debug()) {
-    std::cout << "sort " << adj.size() << " elements subject to " << std::accumulate(adj.begin(), adj.end(), INDEX(0), [](INDEX s, auto& a) { return s + a.size(); }) << " ordering constraints\n";
+    std::cout << "sort " << V << " elements subject to " << edges_.size() << " ordering constraints\n";
   }
-   /*
-   std::vector<bool> visited(V,false);
+
+   build_adjacency_list();
+
+   std::vector<INDEX> in_degree(V,0);
+   for(const auto& e : edges_) {
+      in_degree[e[1]]++;
+   }
+
    std::vector<INDEX> order;
-   std::deque<SIGNED_INDEX> stack; // change to stack
-
-   for(SIGNED_INDEX i=0; i<V; ++i) {
-      if(visited[i] == false) {
-         visited[i] = true;
-         stack.push_back(i);
-         while(!stack.empty()) {
-            auto v = stack.back();
-            stack.pop_back();
-            if(v>=0) {
-               stack.push_back(-v-1);
-               for(SIGNED_INDEX w : adj[v]) {
-                  // if graph is acyclic, then w may not already be
-                  if(!visited[w]) {
-                     visited[w] = true;
-                     stack.push_back(w); 
-                  } 
-               }
-            } else {
-               order.push_back(-v-1); 
-            } 
-         }
+   order.reserve(V);
+   std::vector<INDEX> level_size;
+   for(INDEX i=0; i<V; ++i) {
+      if(in_degree[i] == 0) {
+         order.push_back(i);
       }
    }
-   assert(order.size() == INDEX(V));
-   assert(LP_MP::HasUniqueValues(order));
-   std::reverse(order.begin(),order.end());
-   return std::move(order);
-   */
-
-   constexpr unsigned char notMarked = 0;
-   constexpr unsigned char tempMarked = 1;
-   constexpr unsigned char permMarked = 2;
-   
-   std::vector<unsigned char> mark(V,notMarked); 
-   std::stack<std::pair<INDEX,decltype(adj[0].begin())> > dfs;
-   std::vector<INDEX> postOrder;
-
-   for(INDEX i=0;i<V;i++){
-      if(mark[i] == notMarked) {
-         dfs.push(std::make_pair(i,adj[i].begin()));
-         while(!dfs.empty()){
-            INDEX node = dfs.top().first;
-            auto& it = dfs.top().second;
-            if(mark[node] == tempMarked) {
-               throw std::runtime_error("graph not a dag");
-            }
-            if(it == adj[node].begin()) { // first visit
-               assert(mark[node] == notMarked);
-               mark[node] = permMarked;
-            }
-            while(it != adj[node].end() && mark[*it] != notMarked) {
-               ++it;
+
+   // order[level_begin, level_end) holds the current wavefront, its successors with no remaining predecessors form the next one.
+   std::size_t level_begin = 0;
+   while(level_begin < order.size()) {
+      const std::size_t level_end = order.size();
+      level_size.push_back(level_end - level_begin);
+
+#ifdef LP_MP_PARALLEL
+#pragma omp parallel
+      {
+         std::vector<INDEX> next_level;
+#pragma omp for schedule(guided) nowait
+         for(std::size_t k=level_begin; k<level_end; ++k) {
+            for(const INDEX j : adj[order[k]]) {
+               INDEX remaining;
+#pragma omp atomic capture
+               remaining = --in_degree[j];
+               if(remaining == 0) {
+                  next_level.push_back(j);
+               }
             }
-            if(it != adj[node].end()) {
-               INDEX next = *it;
-               ++it;
-               dfs.top().second = it;
-               dfs.push(std::make_pair(next,adj[next].begin()));
-            } else {
-               dfs.pop();
-               mark[node] = permMarked;
-               postOrder.push_back(node);
+         }
+         // capacity of order is V, hence appending does not move the current wavefront other threads may still read
+#pragma omp critical
+         order.insert(order.end(), next_level.begin(), next_level.end());
+      }
+#else
+      for(std::size_t k=level_begin; k<level_end; ++k) {
+         for(const INDEX j : adj[order[k]]) {
+            if(--in_degree[j] == 0) {
+               order.push_back(j);
             }
          }
       }
+#endif
+      // make ordering independent of thread scheduling
+      std::sort(order.begin() + level_end, order.end());
+      level_begin = level_end;
    }
 
-   assert(postOrder.size() == INDEX(V));
-   assert(LP_MP::HasUniqueValues(postOrder));
-   std::reverse(postOrder.begin(),postOrder.end());
+   if(order.size() != V) {
+      report_cycle(in_degree);
+   }
+
+   wavefronts_ = two_dim_variable_array<INDEX>(uninitialized, level_size.begin(), level_size.end());
+   for(std::size_t l=0, k=0; l<wavefronts_.size(); k+=level_size[l], ++l) {
+      std::copy(order.begin() + k, order.begin() + k + level_size[l], wavefronts_[l].begin());
+   }
 
-   assert(sorting_valid(postOrder));
+   assert(LP_MP::HasUniqueValues(order));
+   assert(sorting_valid(order));
 
-   return std::move(postOrder);
+   return order;
 }
 
 } // end namespace Topological_Sort
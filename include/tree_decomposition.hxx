@@ -4,6 +4,14 @@
 #include "LP_MP.h"
 #include "serialization.hxx"
 #include "union_find.hxx"
+#include <variant>
+#include <tuple>
+#include <set>
+#include <array>
+#include <numeric>
+#include <string>
+#include <fstream>
+#include <cstdint>
 
 namespace LP_MP {
 
@@ -33,6 +41,35 @@ public:
        assert(factors_.size() == tree_messages_.size() + 1);
 
        assert(tree_valid());
+       compile_schedule();
+   }
+
+   // copy tree messages into contiguous arrays per message type.
+   // Consecutive messages of the same type and chirality form a segment, solve processes each segment in a loop over the concrete message type.
+   // Must be called again after tree_messages_ has been changed.
+   void compile_schedule()
+   {
+       std::apply([](auto&... messages) { (messages.clear(), ...); }, schedule_messages_);
+       schedule_.clear();
+       for(const auto& tree_msg : tree_messages_) {
+           const INDEX type = std::get<0>(tree_msg).index();
+           const Chirality c = std::get<1>(tree_msg);
+           std::visit([&](const auto& msg) {
+               auto& messages = std::get<std::vector<std::decay_t<decltype(msg)>>>(schedule_messages_);
+               if(schedule_.empty() || schedule_.back().message_type != type || schedule_.back().c != c) {
+                   schedule_.push_back({type, c, INDEX(messages.size()), INDEX(messages.size())});
+               }
+               messages.push_back(msg);
+               schedule_.back().end++;
+           }, std::get<0>(tree_msg));
+       }
+   }
+
+   bool schedule_compiled() const
+   {
+       INDEX no_scheduled_messages = 0;
+       for(const auto& s : schedule_) { no_scheduled_messages += s.end - s.begin; }
+       return no_scheduled_messages == tree_messages_.size();
    }
 
    // check whether messages are arranged correctly
@@ -107,48 +144,54 @@ public:
    REAL solve()
    {
       assert(factors_.size() == tree_messages_.size() + 1); // otherwise call init
+      assert(schedule_compiled());
       // send messages up the tree
-      for(auto it = tree_messages_.begin(); it!= tree_messages_.end(); ++it) {
-         Chirality c = std::get<1>(*it);
-          std::visit([c](auto&& msg) {
-              msg.send_message_up(c);
-          }, std::get<0>(*it) );
+      for(const auto& s : schedule_) {
+          visit_segment(s, [](auto& messages, const schedule_segment& s) {
+              using message_type = typename std::decay_t<decltype(messages)>::value_type;
+              for(INDEX i=s.begin; i<s.end; ++i) {
+                  messages[i].message_type::send_message_up(s.c);
+              }
+          });
       }
       // compute primal for topmost factor
       // also init primal for top factor, all other primals were initialized already by send_message_up
       REAL value = 0.0;
-      {
-          const Chirality c = std::get<1>(tree_messages_.back());
-          std::visit([&](auto&& msg) {
-              if(c == Chirality::right) {
-                // init primal for right factor!
-                msg.GetRightFactorTypeAdapter()->init_primal();
-                msg.GetRightFactorTypeAdapter()->MaximizePotentialAndComputePrimal();
-                value = msg.GetRightFactorTypeAdapter()->EvaluatePrimal();
-                assert(std::abs(msg.GetRightFactorTypeAdapter()->EvaluatePrimal() - msg.GetRightFactorTypeAdapter()->LowerBound()) <= eps);
-              } else {
-                assert(c == Chirality::left);
-                msg.GetLeftFactorTypeAdapter()->init_primal(); 
-                msg.GetLeftFactorTypeAdapter()->MaximizePotentialAndComputePrimal(); 
-                value = msg.GetLeftFactorTypeAdapter()->EvaluatePrimal();
-                assert(std::abs(msg.GetLeftFactorTypeAdapter()->EvaluatePrimal() - msg.GetLeftFactorTypeAdapter()->LowerBound()) <= eps);
-              } 
-          }, std::get<0>(tree_messages_.back()) );
-      }
+      visit_segment(schedule_.back(), [&](auto& messages, const schedule_segment& s) {
+          auto& msg = messages[s.end-1];
+          if(s.c == Chirality::right) {
+            // init primal for right factor!
+            auto* f = msg.GetRightFactor();
+            f->init_primal();
+            f->MaximizePotentialAndComputePrimal();
+            value = f->EvaluatePrimal();
+            assert(std::abs(f->EvaluatePrimal() - f->LowerBound()) <= eps);
+          } else {
+            assert(s.c == Chirality::left);
+            auto* f = msg.GetLeftFactor();
+            f->init_primal(); 
+            f->MaximizePotentialAndComputePrimal(); 
+            value = f->EvaluatePrimal();
+            assert(std::abs(f->EvaluatePrimal() - f->LowerBound()) <= eps);
+          } 
+      });
       // track down optimal primal solution
-      for(auto it = tree_messages_.rbegin(); it!= tree_messages_.rend(); ++it) {
-         Chirality c = std::get<1>(*it);
-         std::visit([&](auto&& msg) {
-             msg.track_solution_down(c);
-             assert(std::abs(msg.GetLeftFactorTypeAdapter()->EvaluatePrimal() - msg.GetLeftFactorTypeAdapter()->LowerBound()) <= eps);
-             assert(std::abs(msg.GetRightFactorTypeAdapter()->EvaluatePrimal() - msg.GetRightFactorTypeAdapter()->LowerBound()) <= eps);
-             if(c == Chirality::right) {
-                value += msg.GetLeftFactorTypeAdapter()->EvaluatePrimal();
-             } else {
-                assert(c == Chirality::left);
-                value += msg.GetRightFactorTypeAdapter()->EvaluatePrimal();
-             } 
-         }, std::get<0>(*it) );
+      for(auto it = schedule_.rbegin(); it != schedule_.rend(); ++it) {
+          visit_segment(*it, [&](auto& messages, const schedule_segment& s) {
+              using message_type = typename std::decay_t<decltype(messages)>::value_type;
+              for(INDEX i=s.end; i-- > s.begin;) {
+                  auto& msg = messages[i];
+                  msg.message_type::track_solution_down(s.c);
+                  assert(std::abs(msg.GetLeftFactor()->EvaluatePrimal() - msg.GetLeftFactor()->LowerBound()) <= eps);
+                  assert(std::abs(msg.GetRightFactor()->EvaluatePrimal() - msg.GetRightFactor()->LowerBound()) <= eps);
+                  if(s.c == Chirality::right) {
+                      value += msg.GetLeftFactor()->EvaluatePrimal();
+                  } else {
+                      assert(s.c == Chirality::left);
+                      value += msg.GetRightFactor()->EvaluatePrimal();
+                  } 
+              }
+          });
       } 
 
       // check if primal cost is equal to lower bound
@@ -271,14 +314,45 @@ public:
    std::vector<FactorTypeAdapter*> factors_;
 
 protected:
+   struct free_message_vector {
+      template<class FREE_MESSAGE_CONTAINER_TYPE>
+         using invoke = std::vector<FREE_MESSAGE_CONTAINER_TYPE>;
+   };
+   using free_message_storage = meta::apply<meta::quote<std::tuple>, meta::transform< free_message_container_type_list, free_message_vector >>;
+
+   struct schedule_segment {
+      INDEX message_type; // index into free_message_container_type_list
+      Chirality c;
+      INDEX begin, end; // range in messages of type message_type
+   };
+
+   // call op with the array of messages of the segment's type
+   template<typename OP>
+   void visit_segment(const schedule_segment& s, OP op)
+   {
+      visit_segment(s, op, std::make_index_sequence<meta::size<free_message_container_type_list>::value>{});
+   }
+   template<typename OP, std::size_t... I>
+   void visit_segment(const schedule_segment& s, OP& op, std::index_sequence<I...>)
+   {
+      assert(s.message_type < sizeof...(I) && s.begin < s.end);
+      ((s.message_type == I ? op(std::get<I>(schedule_messages_), s) : void()), ...);
+   }
+
+   free_message_storage schedule_messages_;
+   std::vector<schedule_segment> schedule_; // messages in order they are sent up the tree
 };
 
+// subgradients are mostly zero, store nonzero entries as (Lagrangean variable, value) sorted by Lagrangean variable
+using sparse_subgradient_vector = std::vector<std::pair<INDEX,REAL>>;
+
 // factors can be shared among multiple trees. Equality between shared factors is enforced via Lagrangean multipliers
 class Lagrangean_factor_base
 {
 public:
   Lagrangean_factor_base(FactorTypeAdapter* factor)
     : f(factor),
+    dual_(factor->dual_span()),
     no_Lagrangean_vars_(factor->dual_size())
   {}
 
@@ -290,11 +364,47 @@ public:
 
   void serialize_Lagrangean(const double* w, const double scaling)
   {
-    serialization_archive ar(w, no_Lagrangean_vars_*sizeof(REAL));
-    addition_archive l_ar(ar, 1.0*scaling);
-    f->serialize_dual(l_ar);
-    ar.release_memory(); 
+    if(dual_ != nullptr) {
+      REAL* const d = dual_;
+      for(INDEX i=0; i<no_Lagrangean_vars_; ++i) {
+        d[i] += scaling*w[i];
+      }
+    } else {
+      serialization_archive ar(w, no_Lagrangean_vars_*sizeof(REAL));
+      addition_archive l_ar(ar, 1.0*scaling);
+      f->serialize_dual(l_ar);
+      ar.release_memory(); 
+    }
   }
+  // append subgradient entries of Lagrangean variables offset, ..., offset + no_Lagrangean_vars - 1 for current primal solution of f.
+  // active is scratch space
+  void sparse_subgradient(std::vector<INDEX>& active, const INDEX offset, const REAL sign, sparse_subgradient_vector& s)
+  {
+    active.clear();
+    f->sparse_subgradient(active);
+    for(const INDEX j : active) {
+      assert(j < no_Lagrangean_vars_);
+      s.push_back({offset + j, sign});
+    }
+  }
+
+  // add scaling times entries of s for Lagrangean variables offset, ..., offset + no_Lagrangean_vars - 1
+  void add_sparse_Lagrangean(const sparse_subgradient_vector& s, const INDEX offset, const double scaling)
+  {
+    auto it = std::lower_bound(s.begin(), s.end(), offset, [](const auto& e, const INDEX i) { return e.first < i; });
+    if(dual_ != nullptr) {
+      for(; it != s.end() && it->first < offset + no_Lagrangean_vars_; ++it) {
+        dual_[it->first - offset] += scaling*it->second;
+      }
+    } else {
+      std::vector<double> w(no_Lagrangean_vars_, 0.0);
+      for(; it != s.end() && it->first < offset + no_Lagrangean_vars_; ++it) {
+        w[it->first - offset] = it->second;
+      }
+      serialize_Lagrangean(w.data(), scaling);
+    }
+  }
+
   //void copy_fn(double* w)
   //{
   //  f->subgradient(w, +1.0); 
@@ -305,6 +415,7 @@ public:
   //}
 
   FactorTypeAdapter* f;
+  REAL* dual_; // dual variables of f if stored contiguously, then Lagrangean variables are added directly
   const INDEX no_Lagrangean_vars_;
   INDEX global_Lagrangean_vars_offset_; // at which offset are the Lagrangean variables for factor f stored?
   INDEX local_Lagrangean_vars_offset_; // in the mapped subspace, at which position do the Lagrangean variables start?
@@ -353,23 +464,37 @@ public:
     }
   }
 
+  // wi are the Lagrangean variables of the tree
   void serialize_Lagrangean(const double* wi, const double scaling)
   {
-    const double* w = wi + local_Lagrangean_vars_offset_;
+    add_Lagrangean(wi + local_Lagrangean_vars_offset_, scaling);
+  }
+  // w are all Lagrangean variables
+  void serialize_global_Lagrangean(const double* w, const double scaling)
+  {
+    add_Lagrangean(w + global_Lagrangean_vars_offset_, scaling);
+  }
+  void add_sparse_global_Lagrangean(const sparse_subgradient_vector& w, const double scaling)
+  {
+    if(no_connected > 0) {
+      for(INDEX i=0; i<no_connected-1; ++i) {
+        add_sparse_Lagrangean(w, global_Lagrangean_vars_offset_ + i*no_Lagrangean_vars(), scaling);
+      }
+    } else {
+      add_sparse_Lagrangean(w, global_Lagrangean_vars_offset_, -1.0*scaling);
+    }
+  }
+
+  void sparse_subgradient(std::vector<INDEX>& active, sparse_subgradient_vector& s)
+  {
     if(no_connected > 0) {
       assert(no_connected > 1);
       for(INDEX i=0; i<no_connected-1; ++i) {
-        serialization_archive ar(w + i*no_Lagrangean_vars(), Lagrangean_factor_base::no_Lagrangean_vars()*sizeof(REAL));
-        addition_archive l_ar(ar, 1.0*scaling);
-        f->serialize_dual(l_ar);
-        ar.release_memory(); 
+        Lagrangean_factor_base::sparse_subgradient(active, global_Lagrangean_vars_offset_ + i*no_Lagrangean_vars(), +1.0, s);
       }
     } else {
-      serialization_archive ar(w, Lagrangean_factor_base::no_Lagrangean_vars()*sizeof(REAL));
-      addition_archive l_ar(ar, -1.0*scaling);
-      f->serialize_dual(l_ar);
-      ar.release_memory(); 
-    } 
+      Lagrangean_factor_base::sparse_subgradient(active, global_Lagrangean_vars_offset_, -1.0, s);
+    }
   }
 
   void copy_fn(double* wi)
@@ -399,6 +524,18 @@ public:
   }
 
 protected:
+  void add_Lagrangean(const double* w, const double scaling)
+  {
+    if(no_connected > 0) {
+      assert(no_connected > 1);
+      for(INDEX i=0; i<no_connected-1; ++i) {
+        Lagrangean_factor_base::serialize_Lagrangean(w + i*no_Lagrangean_vars(), scaling);
+      }
+    } else {
+      Lagrangean_factor_base::serialize_Lagrangean(w, -1.0*scaling);
+    } 
+  }
+
   INDEX no_connected; // == 0 for negative, == no factors for positive factor. Possibly rename.
 };
 
@@ -435,11 +572,28 @@ public:
 
   void serialize_Lagrangean(const double* wi, const double scaling)
   {
-    const double* w = wi + local_Lagrangean_vars_offset_;
-    serialization_archive ar(w, Lagrangean_factor_base::no_Lagrangean_vars()*sizeof(REAL));
-    addition_archive l_ar(ar, 1.0*scaling);
-    f->serialize_dual(l_ar);
-    ar.release_memory(); 
+    Lagrangean_factor_base::serialize_Lagrangean(wi + local_Lagrangean_vars_offset_, scaling);
+  }
+  void serialize_global_Lagrangean(const double* w, const double scaling)
+  {
+    Lagrangean_factor_base::serialize_Lagrangean(w + global_Lagrangean_vars_offset_, scaling);
+  }
+  void add_sparse_global_Lagrangean(const sparse_subgradient_vector& w, const double scaling)
+  {
+    add_sparse_Lagrangean(w, global_Lagrangean_vars_offset_, scaling);
+  }
+  void sparse_subgradient(std::vector<INDEX>& active, sparse_subgradient_vector& s)
+  {
+    Lagrangean_factor_base::sparse_subgradient(active, global_Lagrangean_vars_offset_, +1.0, s);
+  }
+  // positions of nonzero subgradient entries w.r.t. the Lagrangean variables of the tree. scratch is scratch space
+  void local_subgradient_indices(std::vector<INDEX>& scratch, std::vector<INDEX>& indices)
+  {
+    scratch.clear();
+    f->sparse_subgradient(scratch);
+    for(const INDEX j : scratch) {
+      indices.push_back(local_Lagrangean_vars_offset_ + j);
+    }
   }
   void copy_fn(double* wi)
   {
@@ -595,20 +749,24 @@ public:
    template<typename VECTOR1>
    void compute_mapped_subgradient(VECTOR1& subgradient)
    {
-      //const REAL subgradient_value = compute_subgradient();
-      //assert(false); // assert that subgradient has been computed!
-      std::vector<double> local_subgradient(mapping_.size(),0.0);
-      // write primal solution into subgradient
-      for(auto L : Lagrangean_factors_) {
-         L.copy_fn(&local_subgradient[0]);
-      }
-      assert(mapping_.size() >= dual_size());
-      for(INDEX i=0; i<mapping_.size(); ++i) {
-         assert(mapping_[i] < subgradient.size());
-         subgradient[ mapping_[i] ] += local_subgradient[i];
+      compute_sparse_subgradient();
+      for(const auto& e : subgradient_) {
+         assert(e.first < subgradient.size());
+         subgradient[e.first] += e.second;
       } 
    }
 
+   // write nonzero entries of subgradient w.r.t. all Lagrangean variables into subgradient_
+   void compute_sparse_subgradient()
+   {
+      subgradient_.clear();
+      for(auto& L : Lagrangean_factors_) {
+         L.sparse_subgradient(active_indices_, subgradient_);
+      }
+      std::sort(subgradient_.begin(), subgradient_.end());
+   }
+   const sparse_subgradient_vector& sparse_subgradient() const { return subgradient_; }
+
    template<typename VECTOR>
    void compute_subgradient(VECTOR& subgradient, const REAL step_size)
    {
@@ -648,6 +806,21 @@ public:
       }
    }
 
+   // w are all Lagrangean variables. Lagrangean variables of each factor are mapped to a contiguous range, so no gathering into local weights is needed.
+   void add_global_weights(const double* w, const double scaling)
+   {
+      for(auto& L : Lagrangean_factors_) {
+         L.serialize_global_Lagrangean(w, scaling);
+      }
+   }
+
+   void add_global_weights(const sparse_subgradient_vector& w, const double scaling)
+   {
+      for(auto& L : Lagrangean_factors_) {
+         L.add_sparse_global_Lagrangean(w, scaling);
+      }
+   }
+
   // dual size of Lagrangeans connected to current tree
   INDEX compute_dual_size_in_bytes()
   {
@@ -706,6 +879,9 @@ public:
    INDEX subgradient_size;
    std::vector<int> mapping_;
 
+   sparse_subgradient_vector subgradient_; // of last solution
+   std::vector<INDEX> active_indices_;
+
    std::vector<FactorTypeAdapter*> original_factors_;
 };
 
@@ -716,9 +892,21 @@ class LP_with_trees : public LP<FMC>
 public:
    LP_with_trees(TCLAP::CmdLine& cmd)
      : LP<FMC>(cmd),
-     tree_decomposition_begin_arg_("","treeDecompositionBegin","after how many iterations to start tree decomposition based optimization", false, 0, "", cmd)
+     tree_decomposition_begin_arg_("","treeDecompositionBegin","after how many iterations to start tree decomposition based optimization", false, 0, "", cmd),
+     max_tree_size_arg_("","maxTreeSize","maximum number of factors in automatically constructed trees, 0 for number of factors divided by number of threads", false, 0, "", cmd),
+     import_multipliers_arg_("","importMultipliers","file with Lagrangean multipliers of a previous solve to start from", false, "", "file", cmd),
+     export_multipliers_arg_("","exportMultipliers","file to which Lagrangean multipliers are written at the end of optimization. Only the multipliers are stored, not the internal state of bundle methods", false, "", "file", cmd)
   {}
 
+   void End()
+   {
+      if(export_multipliers_arg_.isSet() && constructed_decomposition) {
+         std::ofstream out(export_multipliers_arg_.getValue(), std::ios::binary);
+         if(!out) { throw std::runtime_error("cannot open multiplier file " + export_multipliers_arg_.getValue()); }
+         export_multipliers(out);
+      }
+   }
+
    ~LP_with_trees()
    {
        redirect_messages_to_original();
@@ -765,11 +953,102 @@ public:
      trees_.push_back(lt);
    }
 
+   // cover all messages that can be used in trees by spanning forests and add their trees.
+   // Forests are grown greedily over messages not covered by previous forests. No tree gets more than max_tree_size factors, so that trees are of similar size for solving them in parallel.
+   void build_tree_decomposition(const std::size_t max_tree_size)
+   {
+      assert(max_tree_size >= 2);
+      const std::size_t n = this->f_.size();
+      const auto edges = tree_edges();
+
+      // root of each tree in current forest. Trees that are not rooted contain only messages usable in both directions and may be oriented from any factor.
+      union_find uf(n);
+      std::vector<INDEX> root(n);
+      std::vector<INDEX> tree_size(n);
+      std::vector<char> rooted(n);
+      auto add_to_forest = [&](const tree_edge& e) {
+         const INDEX l = uf.find(e.left);
+         const INDEX r = uf.find(e.right);
+         if(l == r || tree_size[l] + tree_size[r] > max_tree_size) { return false; }
+         const bool left_upper = e.left_up && (!rooted[r] || root[r] == e.right);
+         const bool right_upper = e.right_up && (!rooted[l] || root[l] == e.left);
+         if(!left_upper && !right_upper) { return false; }
+
+         INDEX new_root;
+         bool new_rooted = true;
+         if(left_upper && right_upper && !rooted[l] && !rooted[r]) {
+            new_root = root[l];
+            new_rooted = false;
+         } else if(left_upper) {
+            new_root = rooted[l] ? root[l] : e.left;
+         } else {
+            new_root = rooted[r] ? root[r] : e.right;
+         }
+         const INDEX new_size = tree_size[l] + tree_size[r];
+         uf.merge(l, r);
+         const INDEX c = uf.find(l);
+         root[c] = new_root;
+         rooted[c] = new_rooted;
+         tree_size[c] = new_size;
+         return true;
+      };
+
+      std::vector<char> covered(n, false);
+      std::vector<INDEX> uncovered(edges.size());
+      std::iota(uncovered.begin(), uncovered.end(), 0);
+      std::vector<INDEX> forest;
+      std::vector<INDEX> remaining;
+      while(!uncovered.empty()) {
+         uf.reset();
+         std::iota(root.begin(), root.end(), 0);
+         std::fill(tree_size.begin(), tree_size.end(), 1);
+         std::fill(rooted.begin(), rooted.end(), false);
+         forest.clear();
+         remaining.clear();
+         for(const INDEX e : uncovered) {
+            if(add_to_forest(edges[e])) {
+               forest.push_back(e);
+            } else {
+               remaining.push_back(e);
+            }
+         }
+         assert(forest.size() > 0);
+         add_forest(edges, forest, uf, root);
+         for(const INDEX e : forest) {
+            covered[edges[e].left] = true;
+            covered[edges[e].right] = true;
+         }
+         std::swap(uncovered, remaining);
+      }
+
+      const auto not_covered = std::find(covered.begin(), covered.end(), false);
+      if(not_covered != covered.end()) {
+         throw std::runtime_error("tree decomposition: factor " + std::to_string(not_covered - covered.begin()) + " has no message that can be used in a tree");
+      }
+      if(debug()) { std::cout << "built tree decomposition with " << trees_.size() << " trees\n"; }
+   }
+
+   void build_tree_decomposition()
+   {
+      std::size_t max_tree_size = max_tree_size_arg_.getValue();
+      if(max_tree_size == 0) {
+#ifdef LP_MP_PARALLEL
+         max_tree_size = (this->f_.size() + omp_get_max_threads() - 1) / omp_get_max_threads();
+#else
+         max_tree_size = this->f_.size();
+#endif
+      }
+      // with at most half of the factors in each tree, models with more than two factors are covered by at least two trees, also when they are tree shaped themselves
+      max_tree_size = std::min(max_tree_size, (this->f_.size() + 1) / 2);
+      build_tree_decomposition(std::max(max_tree_size, std::size_t(2)));
+   }
+
    // find out, which factors are shared between trees and add Lagrangean multipliers for them.
    void construct_decomposition()
    {
        if(constructed_decomposition == true) { return; }
        constructed_decomposition = true;
+       if(trees_.empty()) { build_tree_decomposition(); }
        for(auto& t : trees_) { t.populate_factors(); }
 
       // first, go over all Lagrangean factors in each tree and count how often factor is shared
@@ -791,12 +1070,24 @@ public:
       }
       assert(Lagrangean_factors.size() == this->f_.size()); // otherwise not all factors are covered by trees
 
+      // every tree must share a factor with another tree, otherwise it gets no Lagrangean variables. This fails e.g. for models with only two factors, which form a single tree.
+      std::vector<char> tree_shares_factor(trees_.size(), false);
+      for(const auto& L : Lagrangean_factors) {
+         if(L.second.trees.size() > 1) {
+            for(const auto i : L.second.trees) { tree_shares_factor[i] = true; }
+         }
+      }
+      if(trees_.size() < 2 || std::find(tree_shares_factor.begin(), tree_shares_factor.end(), false) != tree_shares_factor.end()) {
+         throw std::runtime_error("tree decomposition needs at least two trees, each sharing a factor with another tree");
+      }
+
       // copy Lagrangean factors and insert into trees.
       Lagrangean_vars_size_ = 0;
       std::vector<std::unordered_map<FactorTypeAdapter*, FactorTypeAdapter*>> factor_mapping(trees_.size()); // original to copied factor in each tree
-      for(auto& it : Lagrangean_factors) {
-        auto* f = it.first;
-        auto L = it.second;
+      // Lagrangean variables are numbered in the order factors were added, independent of their addresses
+      for(auto* f : this->f_) {
+        if(Lagrangean_factors.find(f) == Lagrangean_factors.end()) { continue; }
+        auto L = Lagrangean_factors.find(f)->second;
         auto& tree_indices = L.trees;
         const auto no_occurences = tree_indices.size();
         if(no_occurences > 1) { // FIXME: we should also clone factors occuring only once
@@ -881,7 +1172,14 @@ public:
       // check map validity: each entry in m (except last one) must occur exactly twice
       assert(mapping_valid()); 
 
-      assert(trees_.size() > 1); // otherwise just solve tree and be done
+      assert(trees_.size() > 1); // ensured above
+
+      multipliers_.assign(Lagrangean_vars_size_, 0.0);
+      if(import_multipliers_arg_.isSet()) {
+         std::ifstream in(import_multipliers_arg_.getValue(), std::ios::binary);
+         if(!in) { throw std::runtime_error("cannot open multiplier file " + import_multipliers_arg_.getValue()); }
+         import_multipliers(in);
+      }
 
       static_cast<DECOMPOSITION_SOLVER*>(this)->construct_decomposition();
    }
@@ -947,6 +1245,75 @@ public:
      return lb; 
    }
 
+   // solve all trees and merge their subgradients into subgradient, return summed cost of trees.
+   // Trees only operate on their own copies of factors and can be solved concurrently.
+   REAL solve_trees(sparse_subgradient_vector& subgradient)
+   {
+     REAL cost = 0.0;
+#pragma omp parallel for schedule(dynamic) reduction(+:cost)
+     for(std::size_t i=0; i<trees_.size(); ++i) {
+       cost += trees_[i].solve();
+       trees_[i].compute_sparse_subgradient();
+     }
+     merge_subgradients(subgradient);
+     return cost;
+   }
+
+   // dense subgradient, as required e.g. by the bundle solver
+   template<typename VECTOR>
+   REAL solve_trees(VECTOR& subgradient)
+   {
+     const REAL cost = solve_trees(merged_subgradient_);
+#pragma omp parallel for
+     for(std::size_t k=0; k<merged_subgradient_.size(); ++k) {
+       assert(merged_subgradient_[k].first < subgradient.size());
+       subgradient[merged_subgradient_[k].first] += merged_subgradient_[k].second;
+     }
+     return cost;
+   }
+
+   // merge sorted subgradients of trees, adding up entries for the same Lagrangean variable and dropping zeros.
+   // Ranges of Lagrangean variables are merged in parallel.
+   void merge_subgradients(sparse_subgradient_vector& merged)
+   {
+     std::size_t no_ranges = 1;
+#ifdef LP_MP_PARALLEL
+     no_ranges = 4*omp_get_max_threads();
+#endif
+     const std::size_t n = no_Lagrangean_vars();
+     auto index_less = [](const auto& e, const INDEX i) { return e.first < i; };
+     std::vector<sparse_subgradient_vector> range_subgradients(no_ranges);
+#pragma omp parallel for schedule(dynamic)
+     for(std::size_t r=0; r<no_ranges; ++r) {
+       const INDEX range_begin = (r*n)/no_ranges;
+       const INDEX range_end = ((r+1)*n)/no_ranges;
+       auto& e = range_subgradients[r];
+       for(const auto& t : trees_) {
+         const auto& s = t.sparse_subgradient();
+         const auto first = std::lower_bound(s.begin(), s.end(), range_begin, index_less);
+         const auto last = std::lower_bound(first, s.end(), range_end, index_less);
+         e.insert(e.end(), first, last);
+       }
+       std::sort(e.begin(), e.end());
+       std::size_t k = 0;
+       for(std::size_t i=0; i<e.size();) {
+         const INDEX idx = e[i].first;
+         REAL v = 0.0;
+         for(; i<e.size() && e[i].first == idx; ++i) { v += e[i].second; }
+         if(v != 0.0) { e[k++] = {idx, v}; }
+       }
+       e.resize(k);
+     }
+
+     std::vector<std::size_t> offset(no_ranges+1, 0);
+     for(std::size_t r=0; r<no_ranges; ++r) { offset[r+1] = offset[r] + range_subgradients[r].size(); }
+     merged.resize(offset.back());
+#pragma omp parallel for
+     for(std::size_t r=0; r<no_ranges; ++r) {
+       std::copy(range_subgradients[r].begin(), range_subgradients[r].end(), merged.begin() + offset[r]);
+     }
+   }
+
    REAL original_factors_lower_bound() const
    {
        return LP<FMC>::LowerBound(); 
@@ -954,16 +1321,85 @@ public:
 
    void add_weights(const double* w, const REAL scaling) 
    {
+#pragma omp parallel for schedule(dynamic)
       for(INDEX i=0; i<trees_.size(); ++i) {
-         auto& tree = trees_[i];
-         const auto& m = tree.mapping();
-         std::vector<double> local_weights;
-         local_weights.reserve(m.size());
-         for(INDEX idx=0; idx<m.size(); ++idx) {
-            local_weights.push_back(w[m[idx]]);
+         trees_[i].add_global_weights(w, scaling);
+      }
+      assert(multipliers_.size() == no_Lagrangean_vars());
+#pragma omp parallel for
+      for(std::size_t i=0; i<multipliers_.size(); ++i) {
+         multipliers_[i] += scaling*w[i];
+      }
+   }
+
+   // only nonzero entries of w are added
+   void add_weights(const sparse_subgradient_vector& w, const REAL scaling) 
+   {
+#pragma omp parallel for schedule(dynamic)
+      for(INDEX i=0; i<trees_.size(); ++i) {
+         trees_[i].add_global_weights(w, scaling);
+      }
+      for(const auto& e : w) {
+         multipliers_[e.first] += scaling*e.second;
+      }
+   }
+
+   // sum of all weights added to the trees
+   const std::vector<REAL>& multipliers() const { return multipliers_; }
+
+   // multipliers at the current point of the decomposition solver. Solvers that keep additional weights outside of the trees override this.
+   std::vector<REAL> current_multipliers() const { return multipliers_; }
+
+   // structural hash of the decomposition: trees, factors shared by them and the Lagrangean variables between the copies.
+   // Independent of costs and factor addresses, hence identical for instances differing only in costs.
+   std::size_t decomposition_hash() const
+   {
+      std::size_t h = hash::hash_combine(trees_.size(), no_Lagrangean_vars());
+      for(const auto& t : trees_) {
+         h = hash::hash_combine(h, t.factors_.size());
+         h = hash::hash_combine(h, t.tree_messages_.size());
+         assert(t.Lagrangean_factors_.size() == t.original_factors_.size());
+         for(std::size_t k=0; k<t.Lagrangean_factors_.size(); ++k) {
+            h = hash::hash_combine(h, this->factor_address_to_index_.find(t.original_factors_[k])->second);
+            h = hash::hash_combine(h, t.Lagrangean_factors_[k].no_Lagrangean_vars());
          }
-         tree.add_weights(&local_weights[0], scaling);
+         for(const INDEX i : t.mapping()) {
+            h = hash::hash_combine(h, i);
+         }
+      }
+      return h;
+   }
+
+   // binary format: magic, decomposition hash, number of Lagrangean variables, multipliers
+   static constexpr std::uint64_t multiplier_file_magic = 0x3147414c504d504c; // "LPMPLAG1"
+
+   void export_multipliers(std::ostream& out) const
+   {
+      assert(constructed_decomposition);
+      const std::vector<REAL> w = static_cast<const DECOMPOSITION_SOLVER*>(this)->current_multipliers();
+      const std::uint64_t header[3] = {multiplier_file_magic, decomposition_hash(), w.size()};
+      out.write(reinterpret_cast<const char*>(header), sizeof(header));
+      out.write(reinterpret_cast<const char*>(w.data()), w.size()*sizeof(REAL));
+      if(!out) { throw std::runtime_error("could not write Lagrangean multipliers"); }
+   }
+
+   // move trees to multipliers stored by export_multipliers for the same decomposition
+   void import_multipliers(std::istream& in)
+   {
+      assert(constructed_decomposition);
+      std::uint64_t header[3];
+      in.read(reinterpret_cast<char*>(header), sizeof(header));
+      if(!in || header[0] != multiplier_file_magic) { throw std::runtime_error("not a Lagrangean multiplier file"); }
+      if(header[1] != decomposition_hash() || header[2] != no_Lagrangean_vars()) { throw std::runtime_error("Lagrangean multipliers were computed for a different tree decomposition"); }
+      std::vector<REAL> w(header[2]);
+      in.read(reinterpret_cast<char*>(w.data()), w.size()*sizeof(REAL));
+      if(!in) { throw std::runtime_error("Lagrangean multiplier file is truncated"); }
+
+      const std::vector<REAL> current = static_cast<const DECOMPOSITION_SOLVER*>(this)->current_multipliers();
+      for(std::size_t i=0; i<w.size(); ++i) {
+         w[i] -= current[i];
       }
+      add_weights(w.data(), 1.0);
    }
 
   // write back reparametrization of tree decomposition factor into original factors
@@ -988,44 +1424,298 @@ public:
   } 
 
 protected:
+   struct message_pointer {
+      template<class MESSAGE_CONTAINER_TYPE>
+         using invoke = MESSAGE_CONTAINER_TYPE*;
+   };
+   using message_pointer_variant = meta::apply<meta::quote<std::variant>, meta::transform< typename FMC::MessageList, message_pointer >>;
+
+   struct tree_edge {
+      INDEX left, right; // factor indices
+      message_pointer_variant msg;
+      bool left_up, right_up; // whether left (right) factor can be the one nearer to the root, i.e. primal can be propagated from it to the other factor
+   };
+
+   std::vector<tree_edge> tree_edges() const
+   {
+      std::vector<tree_edge> edges;
+      tree_edges(edges, std::make_index_sequence<meta::size<typename FMC::MessageList>::value>{});
+      return edges;
+   }
+   template<std::size_t... I>
+   void tree_edges(std::vector<tree_edge>& edges, std::index_sequence<I...>) const
+   {
+      auto add_edges = [&](auto i) {
+         constexpr std::size_t n = decltype(i)::value;
+         using message_type = meta::at_c<typename FMC::MessageList, n>;
+         constexpr bool left_up = message_type::CanComputeRightFromLeftPrimal();
+         constexpr bool right_up = message_type::CanComputeLeftFromRightPrimal();
+         if constexpr(left_up || right_up) {
+            for(auto* m : std::get<n>(this->messages_)) {
+               const INDEX left = this->factor_address_to_index_.find(m->GetLeftFactor())->second;
+               const INDEX right = this->factor_address_to_index_.find(m->GetRightFactor())->second;
+               edges.push_back({left, right, message_pointer_variant(std::in_place_index<n>, m), left_up, right_up});
+            }
+         }
+      };
+      (add_edges(std::integral_constant<std::size_t, I>{}), ...);
+   }
+
+   // orient each tree of the forest away from its root and add it with messages ordered from leaves to root
+   void add_forest(const std::vector<tree_edge>& edges, const std::vector<INDEX>& forest, union_find& uf, const std::vector<INDEX>& root)
+   {
+      const std::size_t n = this->f_.size();
+      std::vector<INDEX> degree(n, 0);
+      for(const INDEX e : forest) {
+         degree[edges[e].left]++;
+         degree[edges[e].right]++;
+      }
+      two_dim_variable_array<INDEX> incident_edges(uninitialized, degree.begin(), degree.end());
+      std::fill(degree.begin(), degree.end(), 0);
+      for(const INDEX e : forest) {
+         incident_edges(edges[e].left, degree[edges[e].left]++) = e;
+         incident_edges(edges[e].right, degree[edges[e].right]++) = e;
+      }
+
+      std::vector<char> visited(n, false);
+      std::vector<std::array<INDEX,2>> order; // factor and edge to its parent
+      for(const INDEX e : forest) {
+         const INDEX r = root[uf.find(edges[e].left)];
+         if(visited[r]) { continue; }
+         order.clear();
+         order.push_back({r, std::numeric_limits<INDEX>::max()});
+         visited[r] = true;
+         for(std::size_t k=0; k<order.size(); ++k) {
+            const INDEX u = order[k][0];
+            for(const INDEX incident : incident_edges[u]) {
+               const INDEX v = edges[incident].left == u ? edges[incident].right : edges[incident].left;
+               if(!visited[v]) {
+                  visited[v] = true;
+                  order.push_back({v, incident});
+               }
+            }
+         }
+
+         factor_tree<FMC> t;
+         for(auto it=order.rbegin(); it+1!=order.rend(); ++it) {
+            const auto& edge = edges[(*it)[1]];
+            const Chirality c = edge.right == (*it)[0] ? Chirality::left : Chirality::right;
+            assert(c == Chirality::left ? edge.left_up : edge.right_up);
+            std::visit([&](auto* m) { t.add_message(m, c); }, edge.msg);
+         }
+         add_tree(t);
+      }
+   }
+
    std::vector<LP_tree_Lagrangean<FMC,LAGRANGEAN_FACTOR>> trees_; // store for each tree the associated Lagrangean factors.
    INDEX Lagrangean_vars_size_;
    TCLAP::ValueArg<INDEX> tree_decomposition_begin_arg_; 
+   TCLAP::ValueArg<INDEX> max_tree_size_arg_;
+   TCLAP::ValueArg<std::string> import_multipliers_arg_;
+   TCLAP::ValueArg<std::string> export_multipliers_arg_;
+   sparse_subgradient_vector merged_subgradient_;
+   std::vector<REAL> multipliers_;
    bool constructed_decomposition = false;
 };
 
 // perform subgradient ascent with Polyak's step size with estimated optimum
+enum class subgradient_method {standard, polyak, nesterov, averaged};
+
 template<typename FMC>
 class LP_subgradient_ascent : public LP_with_trees<FMC, Lagrangean_factor_star, LP_subgradient_ascent<FMC>> // better: perform projected subgradient ascent with Lagrangean_factor_zero_sum
 {
 public:
-   using LP_with_trees<FMC, Lagrangean_factor_star, LP_subgradient_ascent<FMC>>::LP_with_trees;
+   LP_subgradient_ascent(TCLAP::CmdLine& cmd)
+     : LP_with_trees<FMC, Lagrangean_factor_star, LP_subgradient_ascent<FMC>>(cmd),
+     subgradient_method_arg_("","subgradientMethod","update rule for Lagrangean multipliers", false, "standard", "{standard|polyak|nesterov|averaged}", cmd),
+     polyak_target_arg_("","polyakTarget","initial distance of Polyak target above best lower bound, relative to its absolute value", false, 0.05, "", cmd),
+     restart_arg_("","subgradientRestart","iterations without lower bound improvement after which Polyak target is halved and averaging is restarted", false, 10, "", cmd)
+   {}
 
    void construct_decomposition() {}
 
    void optimize_decomposition(const INDEX iteration)
    {
-      REAL current_lower_bound = 0.0;
-      std::vector<REAL> subgradient(this->no_Lagrangean_vars(), 0.0);
-      for(std::size_t i=0; i<this->trees_.size(); ++i) {
-         current_lower_bound += this->trees_[i].solve();
-         this->trees_[i].compute_mapped_subgradient(subgradient); // note that mapping has one extra component!
-         //trees_[i].primal_cost();
+      if(!method_initialized_) {
+         init_method();
       }
 
+      const REAL current_lower_bound = this->solve_trees(subgradient_);
+      assert(std::find_if(subgradient_.begin(), subgradient_.end(), [](const auto& e) { return e.second != 1.0 && e.second != -1.0; }) == subgradient_.end());
+      const bool improved = current_lower_bound > best_lower_bound;
+      if(improved) {
+         no_improvement_ = 0;
+      } else {
+         ++no_improvement_;
+      }
+
+      switch(method_) {
+         case subgradient_method::standard: standard_step(iteration, current_lower_bound); break;
+         case subgradient_method::polyak: polyak_step(current_lower_bound); break;
+         case subgradient_method::nesterov: nesterov_step(current_lower_bound); break;
+         case subgradient_method::averaged: averaged_step(current_lower_bound, improved); break;
+      }
       best_lower_bound = std::max(current_lower_bound, best_lower_bound);
-      assert(std::find_if(subgradient.begin(), subgradient.end(), [](auto x) { return x != 0.0 && x != 1.0 && x != -1.0; }) == subgradient.end());
-      const REAL subgradient_one_norm = std::accumulate(subgradient.begin(), subgradient.end(), 0.0, [=](REAL s, REAL x) { return s + std::abs(x); });
+      previous_lower_bound_ = current_lower_bound;
+   }
+
+private:
+   void init_method()
+   {
+      const std::string& method = subgradient_method_arg_.getValue();
+      if(method == "standard") {
+         method_ = subgradient_method::standard;
+      } else if(method == "polyak") {
+         method_ = subgradient_method::polyak;
+      } else if(method == "nesterov") {
+         method_ = subgradient_method::nesterov;
+      } else if(method == "averaged") {
+         method_ = subgradient_method::averaged;
+      } else {
+         throw std::runtime_error("unknown subgradient method " + method);
+      }
 
-      const REAL step_size = (best_lower_bound - current_lower_bound + subgradient.size())/REAL(subgradient.size() + iteration) / (eps + subgradient_one_norm);
+      const INDEX n = this->no_Lagrangean_vars();
+      if(method_ == subgradient_method::nesterov || method_ == subgradient_method::averaged) {
+         previous_point_ = this->multipliers();
+         best_point_ = this->multipliers();
+         delta_.assign(n, 0.0);
+      }
+      if(method_ == subgradient_method::averaged) {
+         subgradient_sum_.assign(n, 0.0);
+      }
+      polyak_target_ = -1.0;
+      method_initialized_ = true;
+      no_improvement_ = 0;
+      momentum_iteration_ = 0;
+      averaging_iteration_ = 0;
+   }
 
-      std::cout << "stepsize = " << step_size << ", absolute value of subgradient = " << subgradient_one_norm << "\n";
-      this->add_weights(&subgradient[0], step_size);
+   REAL one_norm() const { return std::accumulate(subgradient_.begin(), subgradient_.end(), 0.0, [](REAL s, const auto& e) { return s + std::abs(e.second); }); }
+   REAL squared_norm() const { return std::accumulate(subgradient_.begin(), subgradient_.end(), 0.0, [](REAL s, const auto& e) { return s + e.second*e.second; }); }
+
+   // diminishing step size, decreases faster when far from the best lower bound
+   REAL standard_step_size(const INDEX iteration, const REAL current_lower_bound) const
+   {
+      const REAL n = this->no_Lagrangean_vars();
+      const REAL lb = std::max(best_lower_bound, current_lower_bound);
+      return (lb - current_lower_bound + n)/REAL(n + iteration) / (eps + one_norm());
    }
 
-private:
-   REAL best_lower_bound;
-   REAL step_size;
+   void standard_step(const INDEX iteration, const REAL current_lower_bound)
+   {
+      const REAL step_size = standard_step_size(iteration, current_lower_bound);
+      if(debug()) { std::cout << "stepsize = " << step_size << ", absolute value of subgradient = " << one_norm() << "\n"; }
+      this->add_weights(subgradient_, step_size);
+   }
+
+   // Polyak step towards target value best lower bound + polyak_target_. The target distance is halved whenever the lower bound stalls.
+   void polyak_step(const REAL current_lower_bound)
+   {
+      if(polyak_target_ < 0.0) {
+         polyak_target_ = polyak_target_arg_.getValue() * std::max(REAL(1.0), std::abs(current_lower_bound));
+      }
+      if(no_improvement_ >= restart_arg_.getValue()) {
+         polyak_target_ *= 0.5;
+         no_improvement_ = 0;
+      }
+      const REAL target = std::max(best_lower_bound, current_lower_bound) + polyak_target_;
+      const REAL step_size = (target - current_lower_bound) / (eps + squared_norm());
+      if(debug()) { std::cout << "stepsize = " << step_size << ", target = " << target << "\n"; }
+      this->add_weights(subgradient_, step_size);
+   }
+
+   // set multipliers to target by adding the difference to the trees
+   void move_multipliers(const std::vector<REAL>& target)
+   {
+      const auto& multipliers = this->multipliers();
+#pragma omp parallel for
+      for(std::size_t i=0; i<target.size(); ++i) {
+         delta_[i] = target[i] - multipliers[i];
+      }
+      this->add_weights(delta_.data(), 1.0);
+   }
+
+   // accelerated ascent: subgradient step from extrapolated point y_k to x_{k+1}, then y_{k+1} = x_{k+1} + k/(k+3) (x_{k+1} - x_k).
+   // previous_point_ holds x_k, multipliers hold y_k. Momentum is reset whenever the lower bound decreases.
+   void nesterov_step(const REAL current_lower_bound)
+   {
+      if(current_lower_bound < previous_lower_bound_) {
+         momentum_iteration_ = 0;
+      }
+      const REAL step_size = standard_step_size(momentum_iteration_, current_lower_bound);
+      const REAL beta = REAL(momentum_iteration_)/REAL(momentum_iteration_ + 3);
+      std::vector<REAL> x = this->multipliers();
+      for(const auto& e : subgradient_) {
+         x[e.first] += step_size * e.second;
+      }
+      std::vector<REAL> y(x.size());
+#pragma omp parallel for
+      for(std::size_t i=0; i<x.size(); ++i) {
+         y[i] = x[i] + beta*(x[i] - previous_point_[i]);
+      }
+      std::swap(previous_point_, x);
+      move_multipliers(y);
+      ++momentum_iteration_;
+   }
+
+   // dual averaging: multipliers are anchor + sum of subgradients since last restart, scaled by 1/sqrt(k).
+   // Every subgradientRestart iterations the anchor moves to the best multipliers found so far and the sum is reset.
+   // The first step after a restart is a Polyak step towards best lower bound + polyak_target_.
+   void averaged_step(const REAL current_lower_bound, const bool improved)
+   {
+      if(improved) {
+         best_point_ = this->multipliers();
+      }
+      const bool stalled = no_improvement_ >= restart_arg_.getValue();
+      if(stalled || averaging_iteration_ >= restart_arg_.getValue()) {
+         previous_point_ = best_point_;
+         std::fill(subgradient_sum_.begin(), subgradient_sum_.end(), 0.0);
+         averaging_iteration_ = 0;
+         if(stalled) {
+            polyak_target_ *= 0.5;
+            no_improvement_ = 0;
+         }
+      }
+      if(averaging_iteration_ == 0) {
+         if(polyak_target_ < 0.0) {
+            polyak_target_ = polyak_target_arg_.getValue() * std::max(REAL(1.0), std::abs(current_lower_bound));
+         }
+         const REAL target = std::max(best_lower_bound, current_lower_bound) + polyak_target_;
+         averaging_scale_ = (target - current_lower_bound) / (eps + squared_norm());
+      }
+      for(const auto& e : subgradient_) {
+         subgradient_sum_[e.first] += e.second;
+      }
+      ++averaging_iteration_;
+      const REAL scaling = averaging_scale_ / std::sqrt(REAL(averaging_iteration_));
+      std::vector<REAL> y(this->no_Lagrangean_vars());
+#pragma omp parallel for
+      for(std::size_t i=0; i<y.size(); ++i) {
+         y[i] = previous_point_[i] + scaling*subgradient_sum_[i];
+      }
+      move_multipliers(y);
+   }
+
+   REAL best_lower_bound = -std::numeric_limits<REAL>::infinity();
+   REAL previous_lower_bound_ = -std::numeric_limits<REAL>::infinity();
+   sparse_subgradient_vector subgradient_;
+
+   subgradient_method method_ = subgradient_method::standard;
+   bool method_initialized_ = false;
+   INDEX no_improvement_ = 0;
+   REAL polyak_target_ = -1.0;
+   INDEX momentum_iteration_ = 0;
+   INDEX averaging_iteration_ = 0;
+   REAL averaging_scale_ = 1.0;
+   std::vector<REAL> previous_point_; // nesterov: last iterate x_k, averaged: anchor
+   std::vector<REAL> best_point_; // averaged: multipliers attaining best lower bound
+   std::vector<REAL> subgradient_sum_;
+   std::vector<REAL> delta_;
+
+   TCLAP::ValueArg<std::string> subgradient_method_arg_;
+   TCLAP::ValueArg<REAL> polyak_target_arg_;
+   TCLAP::ValueArg<INDEX> restart_arg_;
 };
 
 } // end namespace LP_MP
@@ -2,20 +2,129 @@
 #define LP_MP_TWO_DIMENSIONAL_VARIABLE_ARRAY_HXX
 
 #include <vector>
+#include <variant>
+#include <memory>
+#include <new>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
 #include <cassert>
 
 namespace LP_MP {
 
-// general two-dimensional array with variable first and second dimension sizes, i.e. like vector<vector<T>>. Holds all data contiguously and therefore may be more efficient than vector<vector<T>>
+// stl compliant allocator returning memory aligned to ALIGNMENT bytes. Used for two_dim_variable_array with aligned rows.
+template<typename T, std::size_t ALIGNMENT>
+class aligned_allocator {
+public:
+  using value_type = T;
+  static_assert(ALIGNMENT >= alignof(T) && (ALIGNMENT & (ALIGNMENT-1)) == 0, "alignment must be a power of two");
+  template<typename T2> struct rebind {using other = aligned_allocator<T2,ALIGNMENT>;};
+
+  aligned_allocator() noexcept {}
+  template<typename T2>
+  aligned_allocator(const aligned_allocator<T2,ALIGNMENT>&) noexcept {}
+
+  T* allocate(std::size_t n) { return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(ALIGNMENT))); }
+  void deallocate(T* p, std::size_t n) { ::operator delete(static_cast<void*>(p), std::align_val_t(ALIGNMENT)); }
+
+  template<typename T2>
+  bool operator==(const aligned_allocator<T2,ALIGNMENT>&) const noexcept { return true; }
+  template<typename T2>
+  bool operator!=(const aligned_allocator<T2,ALIGNMENT>&) const noexcept { return false; }
+};
+
+// allocator adaptor that default-initializes instead of value-initializing on construction without arguments, i.e. std::vector::resize(n) does not zero out memory of trivial types.
+template<typename ALLOCATOR>
+class default_init_allocator : public ALLOCATOR {
+  using traits = std::allocator_traits<ALLOCATOR>;
+public:
+  template<typename T2> struct rebind {using other = default_init_allocator<typename traits::template rebind_alloc<T2>>;};
+
+  using ALLOCATOR::ALLOCATOR;
+  default_init_allocator() = default;
+  default_init_allocator(const ALLOCATOR& a) noexcept : ALLOCATOR(a) {}
+
+  template<typename U>
+  void construct(U* ptr) noexcept(std::is_nothrow_default_constructible<U>::value) { ::new(static_cast<void*>(ptr)) U; }
+  template<typename U, typename... ARGS>
+  void construct(U* ptr, ARGS&&... args) { traits::construct(static_cast<ALLOCATOR&>(*this), ptr, std::forward<ARGS>(args)...); }
+};
 
-// do zrobienia: - alignment?
-//               - custom memory allocator?
-//               - iterators
+// tag for constructing two_dim_variable_array without initializing its entries. Caller must write every entry before reading it.
+struct uninitialized_t {};
+constexpr uninitialized_t uninitialized{};
+
+// rows of two-dimensional arrays, independent of how the rows are stored
 template<typename T>
+struct const_array_slice
+{
+   const_array_slice(const T* begin, const T* end) : begin_(begin), end_(end) { assert(begin <= end); }
+   const T& operator[](const std::size_t i) const { assert(i < size()); return begin_[i]; }
+   std::size_t size() const {  return (end_ - begin_); }
+
+   const T* begin() { return begin_; }
+   const T* end() { return end_; }
+   auto rbegin() { return std::make_reverse_iterator(end()); }
+   auto rend() { return std::make_reverse_iterator(begin()); }
+
+   const T* begin() const { return begin_; }
+   const T* end() const { return end_; }
+   auto rbegin() const { return std::make_reverse_iterator(end()); }
+   auto rend() const { return std::make_reverse_iterator(begin()); }
+
+   private:
+      const T* begin_;
+      const T* end_;
+};
+template<typename T>
+struct array_slice
+{
+   array_slice(T* begin, T* end) : begin_(begin), end_(end) { assert(begin <= end); }
+   template<typename VEC>
+   void operator=(const VEC& o) 
+   { 
+     assert(o.size() == this->size());
+     const auto s = this->size();
+     for(std::size_t i=0; i<s; ++i) {
+       (*this)[i] = o[i];
+     }
+   }
+   const T& operator[](const std::size_t i) const { assert(i < size()); return begin_[i]; }
+   T& operator[](const std::size_t i) { assert(i < size()); return begin_[i]; }
+   std::size_t size() const {  return (end_ - begin_); }
+
+   T* begin() { return begin_; }
+   T* end() { return end_; }
+   auto rbegin() { return std::make_reverse_iterator(end()); }
+   auto rend() { return std::make_reverse_iterator(begin()); }
+
+   T const* begin() const { return begin_; }
+   T const* end() const { return end_; }
+   auto rbegin() const { return std::make_reverse_iterator(end()); }
+   auto rend() const { return std::make_reverse_iterator(begin()); }
+
+   private:
+      T* begin_;
+      T* end_;
+};
+
+// general two-dimensional array with variable first and second dimension sizes, i.e. like vector<vector<T>>. Holds all data contiguously and therefore may be more efficient than vector<vector<T>>
+// OFFSET_TYPE: type for row offsets. std::uint32_t halves the memory needed for offsets, but restricts the total number of entries (plus row padding) to 2^32-1.
+// ALLOCATOR: allocator for the data block, e.g. block_allocator or aligned_allocator.
+// ROW_ALIGNMENT: every row begins at a multiple of ROW_ALIGNMENT entries. For ROW_ALIGNMENT > 1, ALLOCATOR must return memory aligned to ROW_ALIGNMENT*sizeof(T) bytes.
+
+// do zrobienia: - iterators
+template<typename T, typename OFFSET_TYPE = std::size_t, typename ALLOCATOR = std::allocator<T>, std::size_t ROW_ALIGNMENT = 1>
 class two_dim_variable_array
 {
 public:
+   static_assert(std::is_unsigned<OFFSET_TYPE>::value, "offset type must be unsigned");
+   static_assert(ROW_ALIGNMENT > 0, "");
+   using offset_type = OFFSET_TYPE;
+   using allocator_type = ALLOCATOR;
+
    two_dim_variable_array() {}
+   explicit two_dim_variable_array(const ALLOCATOR& a) : data_(a) {}
    ~two_dim_variable_array() {
       static_assert(!std::is_same_v<T,bool>, "value type cannot be bool");
    }
@@ -25,14 +134,14 @@ public:
    two_dim_variable_array(const std::vector<I>& size)
    {
       const std::size_t s = set_dimensions(size.begin(), size.end());
-      data_.resize(s);
+      data_.resize(s, T{});
    }
    // iterator holds size of each dimension of the two dimensional array
    template<typename ITERATOR>
    two_dim_variable_array(ITERATOR size_begin, ITERATOR size_end)
    {
       const std::size_t s = set_dimensions(size_begin, size_end);
-      data_.resize(s);
+      data_.resize(s, T{});
    }
    template<typename ITERATOR>
    two_dim_variable_array(ITERATOR size_begin, ITERATOR size_end, T val)
@@ -40,6 +149,17 @@ public:
       const std::size_t s = set_dimensions(size_begin, size_end);
       data_.resize(s, val);
    }
+   // bulk allocation: entries are default-initialized only, i.e. left indeterminate for trivial types.
+   template<typename ITERATOR>
+   two_dim_variable_array(uninitialized_t, ITERATOR size_begin, ITERATOR size_end)
+   {
+      const std::size_t s = set_dimensions(size_begin, size_end);
+      data_.resize(s);
+   }
+   template<typename I>
+   two_dim_variable_array(uninitialized_t, const std::vector<I>& size)
+   : two_dim_variable_array(uninitialized, size.begin(), size.end())
+   {}
 
    /*
    friend std::ostream& operator<<(std::ostream& os, const two_dim_variable_array<T>& a) {
@@ -57,7 +177,7 @@ public:
    void resize(ITERATOR begin, ITERATOR end)
    {
       const std::size_t size = set_dimensions(begin,end);
-      data_.resize(size); 
+      data_.resize(size, T{}); 
    }
    template<typename ITERATOR>
    void resize(ITERATOR begin, ITERATOR end, T val)
@@ -66,79 +186,32 @@ public:
       data_.resize(size, val); 
    }
 
-   struct ConstArrayAccessObject
-   {
-      ConstArrayAccessObject(const T* begin, const T* end) : begin_(begin), end_(end) { assert(begin <= end); }
-      const T& operator[](const std::size_t i) const { assert(i < size()); return begin_[i]; }
-      std::size_t size() const {  return (end_ - begin_); }
-
-      const T* begin() { return begin_; }
-      const T* end() { return end_; }
-      auto rbegin() { return std::make_reverse_iterator(end()); }
-      auto rend() { return std::make_reverse_iterator(begin()); }
+   using ConstArrayAccessObject = const_array_slice<T>;
+   using ArrayAccessObject = array_slice<T>;
 
-      const T* begin() const { return begin_; }
-      const T* end() const { return end_; }
-      auto rbegin() const { return std::make_reverse_iterator(end()); }
-      auto rend() const { return std::make_reverse_iterator(begin()); }
-
-      private:
-         const T* begin_;
-         const T* end_;
-   };
-   struct ArrayAccessObject
-   {
-      ArrayAccessObject(T* begin, T* end) : begin_(begin), end_(end) { assert(begin <= end); }
-      template<typename VEC>
-      void operator=(const VEC& o) 
-      { 
-        assert(o.size() == this->size());
-        const auto s = this->size();
-        for(std::size_t i=0; i<s; ++i) {
-          (*this)[i] = o[i];
-        }
-      }
-      const T& operator[](const std::size_t i) const { assert(i < size()); return begin_[i]; }
-      T& operator[](const std::size_t i) { assert(i < size()); return begin_[i]; }
-      std::size_t size() const {  return (end_ - begin_); }
-
-      T* begin() { return begin_; }
-      T* end() { return end_; }
-      auto rbegin() { return std::make_reverse_iterator(end()); }
-      auto rend() { return std::make_reverse_iterator(begin()); }
-
-      T const* begin() const { return begin_; }
-      T const* end() const { return end_; }
-      auto rbegin() const { return std::make_reverse_iterator(end()); }
-      auto rend() const { return std::make_reverse_iterator(begin()); }
-
-      private:
-         T* begin_;
-         T* end_;
-   };
    ArrayAccessObject operator[](const std::size_t i) {
       assert(i<this->size());
-      return ArrayAccessObject( &data_[offsets_[i]], &data_[offsets_[i+1]] );
+      return ArrayAccessObject( data_.data() + row_begin(offsets_[i]), data_.data() + offsets_[i+1] );
    }
    ConstArrayAccessObject operator[](const std::size_t i) const {
       assert(i<this->size());
-      return ConstArrayAccessObject( &data_[offsets_[i]], &data_[offsets_[i+1]] );
+      return ConstArrayAccessObject( data_.data() + row_begin(offsets_[i]), data_.data() + offsets_[i+1] );
    }
    const T& operator()(const std::size_t i, const std::size_t j) const
    {
       assert(i<size() && j< (*this)[i].size());
-      return data_[offsets_[i]+j];
+      return data_[row_begin(offsets_[i])+j];
    }
    T& operator()(const std::size_t i, const std::size_t j)
    {
       assert(i < size() && j< (*this)[i].size());
-      return data_[offsets_[i]+j];
+      return data_[row_begin(offsets_[i])+j];
    }
 
    std::size_t size() const { assert(offsets_.size() > 0); return offsets_.size()-1; }
 
    struct iterator : public std::iterator< std::random_access_iterator_tag, T* > {
-     iterator(T* _data, std::size_t* _offset) : data(_data), offset(_offset) {}
+     iterator(T* _data, OFFSET_TYPE* _offset) : data(_data), offset(_offset) {}
      void operator++() { ++offset; }
      void operator--() { --offset; }
      iterator& operator+=(const std::size_t i) { offset+=i; return *this; }
@@ -146,16 +219,16 @@ public:
      iterator operator+(const std::size_t i) { iterator it(data,offset+i); return it; }
      iterator operator-(const std::size_t i) { iterator it(data,offset-i); return it; }
      auto operator-(const iterator it) const { return offset - it.offset; }
-     ArrayAccessObject operator*() { return ArrayAccessObject(data+*offset,data+*(offset+1)); }
-     const ArrayAccessObject operator*() const { return ArrayAccessObject(data+*offset,data+*(offset+1)); }
+     ArrayAccessObject operator*() { return ArrayAccessObject(data+row_begin(*offset),data+*(offset+1)); }
+     const ArrayAccessObject operator*() const { return ArrayAccessObject(data+row_begin(*offset),data+*(offset+1)); }
      bool operator==(const iterator it) const { return data == it.data && offset == it.offset; }
      bool operator!=(const iterator it) const { return !(*this == it); }
      T* data;
-     std::size_t* offset;
+     OFFSET_TYPE* offset;
    };
 
    struct reverse_iterator : public std::iterator_traits< T* > {
-     reverse_iterator(T* _data, std::size_t* _offset) : data(_data), offset(_offset) {}
+     reverse_iterator(T* _data, OFFSET_TYPE* _offset) : data(_data), offset(_offset) {}
      void operator++() { --offset; }
      void operator--() { ++offset; }
      reverse_iterator& operator+=(const std::size_t i) { offset-=i; return *this; }
@@ -163,29 +236,29 @@ public:
      iterator operator+(const std::size_t i) { iterator it(data,offset-i); return it; }
      iterator operator-(const std::size_t i) { iterator it(data,offset+i); return it; }
      auto operator-(const reverse_iterator it) const { return it.offset - offset; }
-     ArrayAccessObject operator*() { return ArrayAccessObject(data+*(offset-1),data+*offset); }
-     const ArrayAccessObject operator*() const { return ArrayAccessObject(data+*(offset-1),data+*offset); }
+     ArrayAccessObject operator*() { return ArrayAccessObject(data+row_begin(*(offset-1)),data+*offset); }
+     const ArrayAccessObject operator*() const { return ArrayAccessObject(data+row_begin(*(offset-1)),data+*offset); }
      bool operator==(const reverse_iterator it) const { return data == it.data && offset == it.offset; }
      bool operator!=(const reverse_iterator it) const { return !(*this == it); }
      T* data;
-     std::size_t* offset;
+     OFFSET_TYPE* offset;
    };
 
-   iterator begin() { return iterator(&data_[0],&offsets_[0]); }
-   iterator end() { return iterator(&data_[0],&offsets_.back()); }
+   iterator begin() { return iterator(data_.data(),&offsets_[0]); }
+   iterator end() { return iterator(data_.data(),&offsets_.back()); }
 
-   reverse_iterator rbegin() { return reverse_iterator(&data_[0],&offsets_.back()); }
-   reverse_iterator rend() { return reverse_iterator(&data_[0],&offsets_[0]); }
+   reverse_iterator rbegin() { return reverse_iterator(data_.data(),&offsets_.back()); }
+   reverse_iterator rend() { return reverse_iterator(data_.data(),&offsets_[0]); }
 
-   struct size_iterator : public std::iterator_traits<const std::size_t*> {
-      size_iterator(const std::size_t* _offset) : offset(_offset) {}
-      std::size_t operator*() const { return *(offset+1) - *offset; } 
+   struct size_iterator : public std::iterator_traits<const OFFSET_TYPE*> {
+      size_iterator(const OFFSET_TYPE* _offset) : offset(_offset) {}
+      std::size_t operator*() const { return *(offset+1) - row_begin(*offset); } 
       void operator++() { ++offset; }
       auto operator-(const size_iterator it) const { return offset - it.offset; }
       size_iterator operator-(const std::size_t i) const { size_iterator it(offset-i); return it; }
       bool operator==(const size_iterator it) const { return offset == it.offset; }
       bool operator!=(const size_iterator it) const { return !(*this == it); }
-      const std::size_t* offset;
+      const OFFSET_TYPE* offset;
    };
 
    auto size_begin() const { assert(offsets_.size() > 0); return size_iterator({&offsets_[0]}); }
@@ -200,29 +273,137 @@ public:
 	   }
    }
 
+   // memory held by offsets and data, without allocator overhead
+   std::size_t size_in_bytes() const { return offsets_.capacity()*sizeof(OFFSET_TYPE) + data_.capacity()*sizeof(T); }
+
 private:
+   // rows start at the first multiple of ROW_ALIGNMENT after the end of the previous row
+   static constexpr std::size_t row_begin(const std::size_t offset)
+   {
+      return ((offset + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT) * ROW_ALIGNMENT;
+   }
+
    template<typename ITERATOR>
    std::size_t set_dimensions(ITERATOR begin, ITERATOR end)
    {
       // first calculate amount of memory needed in bytes
       const auto s = std::distance(begin, end);
       offsets_.clear();
-      offsets_.reserve(s);
+      offsets_.reserve(s+1);
       offsets_.push_back(0);
       for(auto it=begin; it!=end; ++it) {
          assert(*it >= 0);
-         offsets_.push_back( offsets_.back() + *it );
+         const std::size_t row_end = row_begin(offsets_.back()) + std::size_t(*it);
+         if(row_end > std::numeric_limits<OFFSET_TYPE>::max()) {
+            throw std::overflow_error("two_dim_variable_array: number of entries exceeds range of offset type");
+         }
+         offsets_.push_back( OFFSET_TYPE(row_end) );
       }
       return offsets_.back();
    }
 
-   std::vector<std::size_t> offsets_;
-   std::vector<T> data_;
-   // memory is laid out like this:
-   // pointer[1], pointer[2], ... , pointer[dim1], pointer[end], data[1], data[2], ..., data[dim1] .
-   // first pointers to the arrays in the second dimension are stored, then contiguously the data itself.
+   std::vector<OFFSET_TYPE> offsets_;
+   std::vector<T, default_init_allocator<ALLOCATOR>> data_;
+   // offsets_[i+1] holds the end of row i in data_, row i begins at row_begin(offsets_[i]).
+   // For ROW_ALIGNMENT = 1 rows are stored without any gaps.
 };
 
+// variant with 32 bit offsets for large numbers of small rows, e.g. weights in message passing
+template<typename T>
+using compact_two_dim_variable_array = two_dim_variable_array<T, std::uint32_t>;
+
+// uses 32 bit offsets when the total number of entries permits, std::size_t offsets otherwise.
+// Rows are accessed through array_slice for both offset types. Hot loops should go through visit to iterate over the underlying array without dispatching per row.
+template<typename T>
+class adaptive_two_dim_variable_array
+{
+public:
+   using compact_array = compact_two_dim_variable_array<T>;
+   using wide_array = two_dim_variable_array<T>;
+
+   adaptive_two_dim_variable_array() {}
+
+   template<typename I>
+   adaptive_two_dim_variable_array(const std::vector<I>& size)
+   : adaptive_two_dim_variable_array(size.begin(), size.end())
+   {}
+   template<typename ITERATOR>
+   adaptive_two_dim_variable_array(ITERATOR size_begin, ITERATOR size_end)
+   {
+      if(compact_offsets_suffice(size_begin, size_end)) {
+         storage_.template emplace<compact_array>(size_begin, size_end);
+      } else {
+         storage_.template emplace<wide_array>(size_begin, size_end);
+      }
+   }
+   template<typename ITERATOR>
+   adaptive_two_dim_variable_array(ITERATOR size_begin, ITERATOR size_end, T val)
+   {
+      if(compact_offsets_suffice(size_begin, size_end)) {
+         storage_.template emplace<compact_array>(size_begin, size_end, val);
+      } else {
+         storage_.template emplace<wide_array>(size_begin, size_end, val);
+      }
+   }
+   template<typename ITERATOR>
+   adaptive_two_dim_variable_array(uninitialized_t, ITERATOR size_begin, ITERATOR size_end)
+   {
+      if(compact_offsets_suffice(size_begin, size_end)) {
+         storage_.template emplace<compact_array>(uninitialized, size_begin, size_end);
+      } else {
+         storage_.template emplace<wide_array>(uninitialized, size_begin, size_end);
+      }
+   }
+   template<typename I>
+   adaptive_two_dim_variable_array(uninitialized_t, const std::vector<I>& size)
+   : adaptive_two_dim_variable_array(uninitialized, size.begin(), size.end())
+   {}
+
+   // the total number of entries fits into 32 bit offsets
+   template<typename ITERATOR>
+   static bool compact_offsets_suffice(ITERATOR size_begin, ITERATOR size_end)
+   {
+      std::size_t total = 0;
+      for(auto it=size_begin; it!=size_end; ++it) {
+         assert(*it >= 0);
+         total += std::size_t(*it);
+         if(total > std::numeric_limits<typename compact_array::offset_type>::max()) { return false; }
+      }
+      return true;
+   }
+
+   bool compact() const { return storage_.index() == 0; }
+
+   // call f with the underlying compact_array or wide_array
+   template<typename F>
+   decltype(auto) visit(F&& f) { return std::visit(std::forward<F>(f), storage_); }
+   template<typename F>
+   decltype(auto) visit(F&& f) const { return std::visit(std::forward<F>(f), storage_); }
+
+   array_slice<T> operator[](const std::size_t i)
+   {
+      if(compact()) { return (*std::get_if<compact_array>(&storage_))[i]; }
+      return (*std::get_if<wide_array>(&storage_))[i];
+   }
+   const_array_slice<T> operator[](const std::size_t i) const
+   {
+      if(compact()) { return (*std::get_if<compact_array>(&storage_))[i]; }
+      return (*std::get_if<wide_array>(&storage_))[i];
+   }
+   T& operator()(const std::size_t i, const std::size_t j) { return (*this)[i][j]; }
+   const T& operator()(const std::size_t i, const std::size_t j) const { return (*this)[i][j]; }
+
+   std::size_t size() const { return visit([](const auto& a) { return a.size(); }); }
+   std::size_t size_in_bytes() const { return visit([](const auto& a) { return a.size_in_bytes(); }); }
+
+private:
+   std::variant<compact_array, wide_array> storage_;
+};
+
+// every row begins at an address aligned to ROW_ALIGNMENT*sizeof(T) bytes, e.g. for simd loads
+template<typename T, std::size_t ROW_ALIGNMENT, typename OFFSET_TYPE = std::size_t>
+using aligned_two_dim_variable_array = two_dim_variable_array<T, OFFSET_TYPE, aligned_allocator<T, ROW_ALIGNMENT*sizeof(T)>, ROW_ALIGNMENT>;
+
 } // namespace LP_MP
 
 #endif // LP_MP_TWO_DIMENSIONAL_VARIABLE_ARRAY_HXX
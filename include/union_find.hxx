@@ -1,6 +1,13 @@
 #ifndef LP_MP_UNION_FIND_HXX
 #define LP_MP_UNION_FIND_HXX
 
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+
 namespace LP_MP {
 class union_find {
    std::size_t *id, cnt, *sz, N; // it is not necessary to hold sz!
@@ -92,6 +99,96 @@ public:
    }
 };
 
+// union find that can be merged into from many threads concurrently.
+// Roots are linked by index (larger root below smaller one) with compare and swap, finds do path halving.
+// count() and get_contiguous_ids() must not run concurrently with merge().
+class concurrent_union_find {
+   std::vector<std::atomic<std::size_t>> id;
+   static constexpr std::size_t block_size = 1 << 16; // block size for parallel scans
+public:
+   concurrent_union_find(const std::size_t N) : id(N) {
+      reset();
+   }
+   void reset() {
+#pragma omp parallel for
+      for(std::size_t i=0; i<id.size(); ++i) { id[i].store(i, std::memory_order_relaxed); }
+   }
+   std::size_t size() const { return id.size(); }
+
+   std::size_t find(std::size_t p) {
+      assert(p < id.size());
+      while(true) {
+         std::size_t parent = id[p].load(std::memory_order_acquire);
+         if(parent == p) { return p; }
+         const std::size_t grand_parent = id[parent].load(std::memory_order_acquire);
+         if(parent != grand_parent) {
+            // path halving, failure means another thread has changed the pointer already
+            id[p].compare_exchange_weak(parent, grand_parent, std::memory_order_acq_rel);
+         }
+         p = grand_parent;
+      }
+   }
+   void merge(const std::size_t x, const std::size_t y) {
+      std::size_t i = x;
+      std::size_t j = y;
+      while(true) {
+         i = find(i);
+         j = find(j);
+         if(i == j) { return; }
+         if(i < j) { std::swap(i,j); }
+         std::size_t expected = i;
+         if(id[i].compare_exchange_strong(expected, j, std::memory_order_acq_rel)) { return; }
+      }
+   }
+   bool connected(const std::size_t x, const std::size_t y) {
+      std::size_t i = x;
+      std::size_t j = y;
+      while(true) {
+         i = find(i);
+         j = find(j);
+         if(i == j) { return true; }
+         // i might have been linked below another root in the meantime
+         if(id[i].load(std::memory_order_acquire) == i) { return false; }
+      }
+   }
+
+   // Return the number of disjoint sets.
+   std::size_t count() const {
+      std::size_t cnt = 0;
+#pragma omp parallel for reduction(+:cnt)
+      for(std::size_t i=0; i<id.size(); ++i) {
+         if(id[i].load(std::memory_order_relaxed) == i) { ++cnt; }
+      }
+      return cnt;
+   }
+
+   // same layout as for union_find: entry of root gives its contiguous id.
+   std::vector<std::size_t> get_contiguous_ids()
+   {
+      const std::size_t N = id.size();
+      std::vector<std::size_t> id_mapping(N, std::numeric_limits<std::size_t>::max());
+      const std::size_t no_blocks = (N + block_size - 1) / block_size;
+      std::vector<std::size_t> block_offset(no_blocks+1, 0);
+#pragma omp parallel for
+      for(std::size_t b=0; b<no_blocks; ++b) {
+         std::size_t no_roots = 0;
+         for(std::size_t i=b*block_size; i<std::min(N, (b+1)*block_size); ++i) {
+            if(id[i].load(std::memory_order_relaxed) == i) { ++no_roots; }
+         }
+         block_offset[b+1] = no_roots;
+      }
+      std::partial_sum(block_offset.begin(), block_offset.end(), block_offset.begin());
+#pragma omp parallel for
+      for(std::size_t b=0; b<no_blocks; ++b) {
+         std::size_t next_id = block_offset[b];
+         for(std::size_t i=b*block_size; i<std::min(N, (b+1)*block_size); ++i) {
+            if(id[i].load(std::memory_order_relaxed) == i) { id_mapping[i] = next_id++; }
+         }
+      }
+      return id_mapping;
+   }
+};
+
 }; // end namespace LP_MP
 
 #endif // LP_MP_UNION_FIND_HXX
@@ -6,6 +6,9 @@
 #include "mem_use.c"
 #include "tclap/CmdLine.h"
 #include <chrono>
+#include <type_traits>
+#include <sstream>
+#include <iomanip>
 
 /*
  minimal visitor class:
@@ -42,6 +45,8 @@ namespace LP_MP {
             minDualImprovementIntervalArg_("","minDualImprovementInterval","the interval between which at least minimum dual improvement must occur",false,10,&posIntegerConstraint_,cmd),
             standardReparametrizationArg_("","standardReparametrization","mode of reparametrization",false,"anisotropic","{anisotropic|damped_uniform|uniform}",cmd),
             roundingReparametrizationArg_("","roundingReparametrization","mode of reparametrization for rounding primal solution:",false,"damped_uniform","{anisotropic|damped_uniform|uniform}",cmd),
+            checkpointIntervalArg_("","checkpointInterval","checkpoint written every x-th iteration, 0 = never, default = 100",false,100,"non-negative integer",cmd),
+            checkpointSecondsArg_("","checkpointSeconds","checkpoint written every x seconds, 0 = never, default = 0",false,0,"non-negative integer",cmd),
             primalTime_(0)
       {}
 
@@ -59,6 +64,8 @@ namespace LP_MP {
             primalComputationInterval_ = primalComputationIntervalArg_.getValue();
             primalComputationStart_ = primalComputationStartArg_.getValue();
             lowerBoundComputationInterval_ = lowerBoundComputationIntervalArg_.getValue();
+            checkpointInterval_ = checkpointIntervalArg_.getValue();
+            checkpointSeconds_ = checkpointSecondsArg_.getValue();
 
             standardReparametrization_ = LPReparametrizationModeConvert( standardReparametrizationArg_.getValue() );
             roundingReparametrization_ = LPReparametrizationModeConvert( roundingReparametrizationArg_.getValue() );
@@ -117,14 +124,16 @@ namespace LP_MP {
             // output nothing
          } else { 
             if(verbosity >= 1) { 
-              std::cout << "iteration = " << curIter_;
+              std::ostringstream out;
+              out << std::setprecision(10) << "iteration = " << curIter_;
               if(c.computeLowerBound) {
-                std::cout << ", lower bound = " << lowerBound;
+                out << ", lower bound = " << lowerBound;
               }
               if(c.computePrimal) {
-                std::cout << ", upper bound = " << primalBound;
+                out << ", upper bound = " << primalBound;
               }
-              std::cout << ", time elapsed = " << timeElapsed/1000 << "." << (timeElapsed%1000)/10 << "s\n";
+              out << ", time elapsed = " << timeElapsed/1000 << "." << (timeElapsed%1000)/10 << "s\n";
+              std::cout << out.str();
             }
          }
 
@@ -133,6 +142,13 @@ namespace LP_MP {
 
          LpControl ret;
 
+         // rolling checkpoints, either after a number of iterations or after some time has passed
+         if((checkpointInterval_ > 0 && curIter_ - lastCheckpointIter_ >= checkpointInterval_) || (checkpointSeconds_ > 0 && timeElapsed - lastCheckpointTime_ >= 1000*checkpointSeconds_)) {
+            ret.checkpoint = true;
+            lastCheckpointIter_ = curIter_;
+            lastCheckpointTime_ = timeElapsed;
+         }
+
          if(c.computePrimal) {
             prevLowerBound_ = curLowerBound_;
             curLowerBound_ = lowerBound;
@@ -193,8 +209,10 @@ namespace LP_MP {
       {
          auto endTime = std::chrono::steady_clock::now();
          if(verbosity >= 1) { 
-           std::cout << "final lower bound = " << lower_bound << ", upper bound = " << upper_bound << "\n";
-           std::cout << "Optimization took " <<  std::chrono::duration_cast<std::chrono::milliseconds>(endTime - beginTime_).count() << " milliseconds and " << curIter_ << " iterations.\n";
+           std::ostringstream out;
+           out << std::setprecision(10) << "final lower bound = " << lower_bound << ", upper bound = " << upper_bound << "\n";
+           out << "Optimization took " <<  std::chrono::duration_cast<std::chrono::milliseconds>(endTime - beginTime_).count() << " milliseconds and " << curIter_ << " iterations.\n";
+           std::cout << out.str();
          }
       }
       
@@ -203,6 +221,25 @@ namespace LP_MP {
       //`REAL GetLowerBound() const { return curLowerBound_; }
       INDEX GetIter() const { return curIter_; }
 
+      // iteration counter and lower bound history, stored in checkpoints. When loading, remaining iterations are counted from the restored iteration.
+      // Saving must not change the state: checkpoints are written right after visit, which may have decided to stop.
+      template<typename ARCHIVE>
+      void serialize_state(ARCHIVE& ar)
+      {
+         INDEX no_lower_bounds = lowerBound_.size();
+         ar(curIter_, prevLowerBound_, curLowerBound_, no_lower_bounds);
+         if constexpr(std::is_same<ARCHIVE, load_archive>::value) {
+            lowerBound_.resize(no_lower_bounds);
+         }
+         if(no_lower_bounds > 0) {
+            ar(lowerBound_);
+         }
+         if constexpr(std::is_same<ARCHIVE, load_archive>::value) {
+            remainingIter_ = curIter_ < maxIter_ ? maxIter_ - curIter_ : 1;
+            lastCheckpointIter_ = curIter_;
+         }
+      }
+
       protected:
       PositiveRealConstraint posRealConstraint_;
       PositiveIntegerConstraint posIntegerConstraint_;
@@ -218,6 +255,8 @@ namespace LP_MP {
       TCLAP::ValueArg<INDEX> minDualImprovementIntervalArg_;
       TCLAP::ValueArg<std::string> standardReparametrizationArg_;
       TCLAP::ValueArg<std::string> roundingReparametrizationArg_;
+      TCLAP::ValueArg<INDEX> checkpointIntervalArg_;
+      TCLAP::ValueArg<INDEX> checkpointSecondsArg_;
 
       // command line arguments read out
       INDEX maxIter_;
@@ -229,6 +268,8 @@ namespace LP_MP {
       INDEX lowerBoundComputationInterval_;
       REAL minDualImprovement_;
       INDEX minDualImprovementInterval_;
+      INDEX checkpointInterval_;
+      INDEX checkpointSeconds_;
       std::vector<REAL> lowerBound_; // do zrobienia: possibly make circular list out of this
       // do zrobienia: make enum for reparametrization mode
       LPReparametrizationMode standardReparametrization_;
@@ -239,6 +280,8 @@ namespace LP_MP {
       INDEX curIter_ = 0;
       REAL prevLowerBound_ = -std::numeric_limits<REAL>::max();
       REAL curLowerBound_ = -std::numeric_limits<REAL>::max();
+      INDEX lastCheckpointIter_ = 0;
+      INDEX lastCheckpointTime_ = 0; // milliseconds
       TimeType beginTime_;
 
       // primal
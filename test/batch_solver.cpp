@@ -0,0 +1,57 @@
+#include "test.h"
+#include "test_model.hxx"
+#include "batch_solver.hxx"
+#include "visitors/standard_visitor.hxx"
+#include <stdexcept>
+#include <thread>
+
+using namespace LP_MP;
+
+using solver_type = Solver<LP<test_FMC>, StandardVisitor>;
+
+int main(int argc, char** argv)
+{
+   const std::vector<std::string> options = {"batch solver test", "--maxIter", "20", "--verbosity", "0"};
+   const INDEX no_instances = 32;
+   auto chain_length = [](const INDEX i) { return 100 + 37*i; };
+
+   // concurrently solved instances give the same bounds as sequentially solved ones
+   {
+      verbosity = 1;
+      const auto results = solve_batch<solver_type>(no_instances, options, [&](solver_type& s, const INDEX i) { build_chain(s.GetLP(), chain_length(i)); }, 4);
+      test(verbosity == 1); // workers do not change the verbosity of the calling thread
+      verbosity = 0;
+      test(results.size() == no_instances);
+      for(INDEX i=0; i<no_instances; ++i) {
+         solver_type s(options);
+         build_chain(s.GetLP(), chain_length(i));
+         test(s.Solve() == results[i].status);
+         test(s.lower_bound() == results[i].lower_bound);
+         test(s.primal_cost() == results[i].primal_cost);
+      }
+   }
+
+   // threads on which verbosity was never set, e.g. OpenMP workers, use the level set last
+   {
+      verbosity = 2;
+      INDEX v = 0;
+      std::thread([&v]() { v = verbosity; }).join();
+      test(v == 2);
+      std::thread([&v]() { verbosity = 1; v = verbosity; }).join();
+      test(v == 1);
+      test(verbosity == 2);
+      verbosity = 0;
+   }
+
+   // exceptions thrown for single instances are passed to the caller after all workers have finished
+   {
+      bool thrown = false;
+      try {
+         solve_batch<solver_type>(8, options, [&](solver_type& s, const INDEX i) {
+               if(i == 5) { throw std::runtime_error("invalid instance"); }
+               build_chain(s.GetLP(), chain_length(i));
+               });
+      } catch(const std::runtime_error&) { thrown = true; }
+      test(thrown);
+   }
+}
@@ -0,0 +1,241 @@
+#include "test.h"
+#include "test_model.hxx"
+#include "solver.hxx"
+#include "visitors/standard_visitor.hxx"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace LP_MP;
+
+using solver_type = Solver<LP<test_FMC>, StandardVisitor>;
+
+struct test_solver : public solver_type {
+   using solver_type::solver_type;
+   using solver_type::best_primal_;
+};
+
+struct exposed_visitor : public StandardVisitor {
+   using StandardVisitor::StandardVisitor;
+   using StandardVisitor::remainingIter_;
+};
+
+struct visitor_test_solver : public Solver<LP<test_FMC>, exposed_visitor> {
+   using Solver<LP<test_FMC>, exposed_visitor>::Solver;
+   using Solver<LP<test_FMC>, exposed_visitor>::visitor_;
+};
+
+INDEX& primal(solver_type& s, const INDEX i)
+{
+   return static_cast<test_FMC::factor*>(s.GetLP().GetFactor(i))->GetFactor()->primal;
+}
+
+int main(int argc, char** argv)
+{
+   const std::string filename = "test_checkpoint.bin";
+
+   // resuming from a checkpoint restores reparametrization, primal, bounds and iteration count
+   {
+      solver_type s({"checkpoint test", "--maxIter", "10", "-v", "0"});
+      build_chain(s.GetLP(), 100);
+      s.Solve();
+      s.save_checkpoint(filename);
+
+      solver_type r({"checkpoint test", "--maxIter", "10", "-v", "0"});
+      build_chain(r.GetLP(), 100);
+      test(std::abs(r.GetLP().LowerBound() - s.GetLP().LowerBound()) > eps);
+      r.load_checkpoint(filename);
+      test(std::abs(r.GetLP().LowerBound() - s.GetLP().LowerBound()) <= eps);
+      test(r.lower_bound() == s.lower_bound());
+      test(r.primal_cost() == s.primal_cost());
+      for(INDEX i=0; i<s.GetLP().GetNumberOfFactors(); ++i) {
+         test(primal(s,i) == primal(r,i));
+      }
+   }
+
+   // the best primal is kept as binary snapshot, restored from checkpoints and written back into factors only on demand
+   {
+      test_solver s({"checkpoint test", "-v", "0"});
+      build_chain(s.GetLP(), 100);
+      test(s.best_primal_.empty());
+      std::vector<INDEX> best;
+      for(INDEX i=0; i<s.GetLP().GetNumberOfFactors(); ++i) {
+         primal(s,i) = 0;
+         best.push_back(0);
+      }
+      s.RegisterPrimal();
+      test(s.primal_cost() < std::numeric_limits<REAL>::infinity());
+      test(!s.best_primal_.empty());
+      s.save_checkpoint(filename);
+      for(INDEX i=0; i<s.GetLP().GetNumberOfFactors(); ++i) {
+         primal(s,i) = 1;
+      }
+      s.best_primal_string();
+      for(INDEX i=0; i<s.GetLP().GetNumberOfFactors(); ++i) {
+         test(primal(s,i) == 1);
+      }
+
+      test_solver r({"checkpoint test", "-v", "0"});
+      build_chain(r.GetLP(), 100);
+      test(r.best_primal_.empty());
+      r.load_checkpoint(filename);
+      test(r.best_primal_.size() == s.best_primal_.size());
+      r.best_primal_.load();
+      for(INDEX i=0; i<r.GetLP().GetNumberOfFactors(); ++i) {
+         test(primal(r,i) == best[i]);
+      }
+   }
+
+   // the best primal solution is a section of its own, incremental checkpoints only store its changed blocks
+   {
+      test_solver s({"checkpoint test", "-v", "0"});
+      build_chain(s.GetLP(), 2000);
+      for(INDEX i=0; i<s.GetLP().GetNumberOfFactors(); ++i) {
+         primal(s,i) = 0;
+      }
+      s.RegisterPrimal();
+      auto no_state = [](auto& ar) {};
+      checkpoint::background_writer w(filename, 0.0, 100);
+      w.submit(s.GetLP(), s.best_primal_, no_state);
+      w.finish();
+      primal(s,7) = 1;
+      s.best_primal_.save(s.GetLP());
+      w.submit(s.GetLP(), s.best_primal_, no_state);
+      w.finish();
+      std::ifstream delta(filename + ".delta", std::ios::binary | std::ios::ate);
+      test(delta.is_open() && delta.tellg() > 0 && delta.tellg() < s.best_primal_.size()/10);
+      delta.close();
+
+      test_solver r({"checkpoint test", "-v", "0"});
+      build_chain(r.GetLP(), 2000);
+      checkpoint::read(filename, r.GetLP(), r.best_primal_, no_state);
+      test(r.best_primal_.size() == s.best_primal_.size());
+      r.best_primal_.load();
+      for(INDEX i=0; i<r.GetLP().GetNumberOfFactors(); ++i) {
+         test(primal(r,i) == (i == 7 ? 1 : 0));
+      }
+   }
+
+   // incremental checkpoints are appended to a delta log, a torn last record is ignored
+   {
+      solver_type s({"checkpoint test", "--maxIter", "20", "--checkpointFile", filename, "--checkpointInterval", "2", "--checkpointFullInterval", "100", "-v", "0"});
+      build_chain(s.GetLP(), 2000);
+      s.Solve();
+      std::ifstream delta(filename + ".delta", std::ios::binary | std::ios::ate);
+      test(delta.is_open() && delta.tellg() > 0);
+      delta.close();
+      std::ofstream torn(filename + ".delta", std::ios::binary | std::ios::app);
+      torn.write("\x4c\x50\x4d", 3);
+      torn.close();
+
+      solver_type r({"checkpoint test", "-v", "0"});
+      build_chain(r.GetLP(), 2000);
+      r.load_checkpoint(filename);
+      test(std::abs(r.GetLP().LowerBound() - s.GetLP().LowerBound()) <= eps);
+      test(r.lower_bound() == s.lower_bound());
+   }
+
+   // with a tolerance, restored duals deviate from the checkpointed ones by at most the tolerance
+   {
+      const REAL tolerance = 1e-2;
+      solver_type s({"checkpoint test", "--maxIter", "20", "--checkpointFile", filename, "--checkpointInterval", "2", "--checkpointTolerance", std::to_string(tolerance), "-v", "0"});
+      build_chain(s.GetLP(), 2000);
+      s.Solve();
+
+      solver_type r({"checkpoint test", "-v", "0"});
+      build_chain(r.GetLP(), 2000);
+      r.load_checkpoint(filename);
+      for(INDEX i=0; i<s.GetLP().GetNumberOfFactors(); ++i) {
+         auto* f = static_cast<test_FMC::factor*>(s.GetLP().GetFactor(i))->GetFactor();
+         auto* g = static_cast<test_FMC::factor*>(r.GetLP().GetFactor(i))->GetFactor();
+         for(INDEX j=0; j<f->cost.size(); ++j) {
+            test(std::abs(f->cost[j] - g->cost[j]) <= tolerance + eps);
+         }
+      }
+   }
+
+   // writing a checkpoint does not cancel a stop decided by the visitor, loading one recomputes the remaining iterations
+   {
+      visitor_test_solver s({"checkpoint test", "--maxIter", "10", "-v", "0"});
+      build_chain(s.GetLP(), 100);
+      s.Solve();
+      s.visitor_.remainingIter_ = 7;
+      s.save_checkpoint(filename);
+      test(s.visitor_.remainingIter_ == 7);
+      s.visitor_.remainingIter_ = 5;
+      s.load_checkpoint(filename);
+      test(s.visitor_.remainingIter_ == 1); // checkpoint was written after the last iteration
+   }
+
+   // the tolerance only applies to duals of factors verified to be contiguous REALs, all other bytes are compared exactly
+   {
+      auto write_real = [](std::vector<char>& v, const std::size_t pos, const REAL x) { std::memcpy(v.data() + pos, &x, sizeof(REAL)); };
+      const std::vector<std::pair<std::size_t, std::size_t>> ranges = {{4, 4 + 3*sizeof(REAL)}};
+      const std::size_t size = 64;
+      std::vector<char> prev(size, 0);
+      std::vector<char> cur = prev;
+      write_real(cur, 4 + sizeof(REAL), 1e-3);
+      test(!checkpoint::block_changed(cur.data(), prev.data(), 0, size, ranges, 1e-2));
+      test(checkpoint::block_changed(cur.data(), prev.data(), 0, size, ranges, 0.0));
+      // same change in bytes outside of the ranges
+      write_real(cur, 40, 1e-3);
+      test(checkpoint::block_changed(cur.data(), prev.data(), 0, size, ranges, 1e-2));
+      // REALs crossing the block boundary are compared exactly in both blocks
+      cur = prev;
+      write_real(cur, 4 + sizeof(REAL), 1e-3);
+      test(checkpoint::block_changed(cur.data(), prev.data(), 0, 16, ranges, 1e-2));
+      test(checkpoint::block_changed(cur.data(), prev.data(), 16, size, ranges, 1e-2));
+      cur = prev;
+      write_real(cur, 4 + 2*sizeof(REAL), 1e-3);
+      test(!checkpoint::block_changed(cur.data(), prev.data(), 0, 16, ranges, 1e-2));
+      test(!checkpoint::block_changed(cur.data(), prev.data(), 16, size, ranges, 1e-2));
+   }
+
+   // checkpoints of structurally different models are rejected
+   {
+      solver_type r({"checkpoint test", "-v", "0"});
+      build_chain(r.GetLP(), 99);
+      bool thrown = false;
+      try { r.load_checkpoint(filename); } catch(const std::runtime_error&) { thrown = true; }
+      test(thrown);
+   }
+
+   // whole-LP snapshots: contiguous duals are saved, added and loaded in one block per factor
+   {
+      solver_type s({"checkpoint test", "-v", "0"});
+      build_chain(s.GetLP(), 1000);
+      auto& lp = s.GetLP();
+      auto cost = [&](const INDEX i) -> vector<REAL>& { return static_cast<test_FMC::factor*>(lp.GetFactor(i))->GetFactor()->cost; };
+
+      const auto offsets = factor_offsets(lp, serialization_functor::dual{});
+      test(offsets.back() == 2*sizeof(REAL)*lp.GetNumberOfFactors());
+      std::vector<REAL> duals(2*lp.GetNumberOfFactors());
+      serialize_factors<save_archive>(lp, (char*) duals.data(), offsets, serialization_functor::dual{});
+      for(INDEX i=0; i<lp.GetNumberOfFactors(); ++i) {
+         test(lp.GetFactor(i)->dual_span() == cost(i).begin());
+         test(duals[2*i] == cost(i)[0] && duals[2*i+1] == cost(i)[1]);
+      }
+
+      serialize_factors<addition_archive>(lp, (char*) duals.data(), offsets, serialization_functor::dual{}, REAL(2.0));
+      for(INDEX i=0; i<lp.GetNumberOfFactors(); ++i) {
+         test(std::abs(cost(i)[0] - 3.0*duals[2*i]) <= eps && std::abs(cost(i)[1] - 3.0*duals[2*i+1]) <= eps);
+      }
+
+      serialize_factors<load_archive>(lp, (char*) duals.data(), offsets, serialization_functor::dual{});
+      factor_archive<serialization_functor::dual> snapshot(lp);
+      cost(7)[0] += 1.0;
+      snapshot.load_factor(lp.GetFactor(7));
+      test(cost(7)[0] == duals[14]);
+
+      // clones have their own dual storage
+      FactorTypeAdapter* c = lp.GetFactor(3)->clone();
+      test(c->dual_span() != nullptr && c->dual_span() != lp.GetFactor(3)->dual_span());
+      test(c->dual_size() == 2);
+      delete c;
+   }
+
+   std::remove(filename.c_str());
+   std::remove((filename + ".delta").c_str());
+}
@@ -1,6 +1,10 @@
 #include "test.h"
 #include "graph.hxx"
 #include <unordered_map>
+#include <list>
+#include <random>
+#include <deque>
+#include <limits>
 
 using namespace LP_MP;
 
@@ -46,4 +50,80 @@ int main(int argc, char** argv)
 	decltype(edges) contraction_edges({{0,2}});
 	auto [contracted_graph, contraction_mapping] = g.contract(contraction_edges.begin(), contraction_edges.end());
 	test(contracted_graph.no_nodes() == 3);
+
+	// construction from random access and forward iterators must give the same graph
+	{
+		std::mt19937 gen(0);
+		std::uniform_int_distribution<std::size_t> node_dist(0,199);
+		std::vector<std::array<std::size_t,2>> random_edges;
+		for(std::size_t e=0; e<2000; ++e) {
+			const std::size_t i = node_dist(gen);
+			const std::size_t j = node_dist(gen);
+			if(i != j) { random_edges.push_back({std::min(i,j), std::max(i,j)}); }
+		}
+		std::sort(random_edges.begin(), random_edges.end());
+		random_edges.erase(std::unique(random_edges.begin(), random_edges.end()), random_edges.end());
+		std::list<std::array<std::size_t,2>> random_edges_list(random_edges.begin(), random_edges.end());
+
+		auto edge_info = [](const auto& e) { return e[0]*1000 + e[1]; };
+		graph<std::size_t> g_parallel(random_edges.begin(), random_edges.end(), edge_info);
+		graph<std::size_t> g_sequential(random_edges_list.begin(), random_edges_list.end(), edge_info);
+
+		test(g_parallel.no_nodes() == g_sequential.no_nodes());
+		for(std::size_t i=0; i<g_parallel.no_nodes(); ++i) {
+			test(g_parallel.no_edges(i) == g_sequential.no_edges(i));
+			for(auto it_p=g_parallel.begin(i), it_s=g_sequential.begin(i); it_p!=g_parallel.end(i); ++it_p, ++it_s) {
+				test(it_p->head() == it_s->head());
+				test(it_p->edge() == it_s->edge());
+				test(it_p->edge() == std::min(i,it_p->head())*1000 + std::max(i,it_p->head()));
+				test(&it_p->sister().sister() == &(*it_p));
+				test(it_p->sister().head() == i);
+			}
+		}
+
+		// batched path search must find shortest paths, both for queries grouped by start node and for single ones
+		std::vector<std::array<std::size_t,2>> queries;
+		for(std::size_t q=0; q<300; ++q) {
+			const std::size_t i = node_dist(gen) % 20; // few start nodes, so that queries are grouped
+			const std::size_t j = node_dist(gen);
+			if(i != j) { queries.push_back({i,j}); }
+		}
+		for(std::size_t i=20; i<60; ++i) {
+			const std::size_t j = node_dist(gen);
+			if(i != j) { queries.push_back({i,j}); }
+		}
+		auto mask_op = [](const std::size_t i, const std::size_t j, const std::size_t e) { return e % 3 != 0; };
+		const auto paths = find_paths(g_parallel, queries.begin(), queries.end(), mask_op);
+		test(paths.size() == queries.size());
+		// number of edges on shortest paths by plain bfs, infinity if not reachable
+		auto distance = [&](const std::size_t start, const std::size_t end) {
+			std::vector<std::size_t> d(g_parallel.no_nodes(), std::numeric_limits<std::size_t>::max());
+			std::deque<std::size_t> visit = {start};
+			d[start] = 0;
+			while(!visit.empty()) {
+				const std::size_t i = visit.front();
+				visit.pop_front();
+				for(auto it=g_parallel.begin(i); it!=g_parallel.end(i); ++it) {
+					if(d[it->head()] == std::numeric_limits<std::size_t>::max() && mask_op(i, it->head(), it->edge())) {
+						d[it->head()] = d[i] + 1;
+						visit.push_back(it->head());
+					}
+				}
+			}
+			return d[end];
+		};
+		for(std::size_t q=0; q<queries.size(); ++q) {
+			const std::size_t dist = distance(queries[q][0], queries[q][1]);
+			test(paths[q].size() == (dist == std::numeric_limits<std::size_t>::max() ? 0 : dist+1));
+			if(paths[q].size() > 0) {
+				test(paths[q].front() == queries[q][0] && paths[q].back() == queries[q][1]);
+				for(std::size_t k=0; k+1<paths[q].size(); ++k) {
+					const std::size_t i = paths[q][k];
+					const std::size_t j = paths[q][k+1];
+					test(g_parallel.edge_present(i,j));
+					test(mask_op(i,j,std::min(i,j)*1000 + std::max(i,j)));
+				}
+			}
+		}
+	}
 }
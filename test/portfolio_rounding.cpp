@@ -0,0 +1,93 @@
+#include "test.h"
+#include "test_model.hxx"
+#include "solver.hxx"
+#include "visitors/standard_visitor.hxx"
+#include <cmath>
+
+using namespace LP_MP;
+
+// primal is only propagated further when it changed, otherwise propagation would not terminate
+struct rounding_message : public test_message {
+  template<typename LEFT_FACTOR, typename RIGHT_FACTOR>
+  bool ComputeRightFromLeftPrimal(const LEFT_FACTOR& l, RIGHT_FACTOR& r)
+  {
+    const bool changed = r.primal != l.primal;
+    r.primal = l.primal;
+    return changed;
+  }
+
+  template<typename LEFT_FACTOR, typename RIGHT_FACTOR>
+  bool ComputeLeftFromRightPrimal(LEFT_FACTOR& l, const RIGHT_FACTOR& r)
+  {
+    const bool changed = l.primal != r.primal;
+    l.primal = r.primal;
+    return changed;
+  }
+};
+
+// test model with primal computation during message passing
+struct rounding_FMC {
+  constexpr static const char* name = "rounding test model";
+  using factor = FactorContainer<test_factor, rounding_FMC, 0, true>;
+  using message = MessageContainer<rounding_message, 0, 0, message_passing_schedule::left, variableMessageNumber, variableMessageNumber, rounding_FMC, 0>;
+  using FactorList = meta::list<factor>;
+  using MessageList = meta::list<message>;
+  using ProblemDecompositionList = meta::list<>;
+};
+using solver_type = Solver<LP<rounding_FMC>, StandardVisitor>;
+
+int main(int argc, char** argv)
+{
+   const std::vector<std::string> options = {"portfolio rounding test", "--maxIter", "20", "-v", "0"};
+
+   solver_type plain(options);
+   build_chain(plain.GetLP(), 500);
+   plain.Solve();
+
+   // rounding works on copies of the model, hence the lower bound progresses exactly as without rounding
+   {
+      PortfolioRoundingSolver<solver_type> s(options);
+      build_chain(s.GetLP(), 500);
+      s.Solve();
+      test(s.lower_bound() == plain.lower_bound());
+      test(std::isfinite(s.primal_cost()));
+      test(s.primal_cost() >= s.lower_bound() - eps);
+   }
+
+   // a copy of the model reparametrized by the snapshot of the dual rounds exactly as the solved LP
+   {
+      solver_type s(options);
+      build_chain(s.GetLP(), 500);
+      s.Solve();
+      auto& lp = s.GetLP();
+
+      TCLAP::CmdLine cmd("copy");
+      LP<rounding_FMC> copy(cmd);
+      copy.copy_model(lp);
+      test(copy.GetNumberOfFactors() == lp.GetNumberOfFactors());
+      test(copy.GetNumberOfMessages() == lp.GetNumberOfMessages());
+
+      factor_archive<serialization_functor::dual> snapshot(lp);
+      serialize_factors<load_archive>(copy, snapshot.data(), factor_offsets(copy, serialization_functor::dual{}), serialization_functor::dual{});
+      test(copy.LowerBound() == lp.LowerBound());
+
+      lp.set_reparametrization(LPReparametrizationMode::Anisotropic);
+      copy.set_reparametrization(LPReparametrizationMode::Anisotropic);
+      lp.ComputeForwardPassAndPrimal(1000);
+      copy.ComputeForwardPassAndPrimal(1000);
+      test(std::isfinite(copy.EvaluatePrimal()));
+      test(copy.EvaluatePrimal() == lp.EvaluatePrimal());
+      test(copy.LowerBound() == lp.LowerBound());
+   }
+
+   // the portfolio can be restricted to single strategies
+   for(const auto strategy : {rounding_strategy::forward_mp, rounding_strategy::backward_mp, rounding_strategy::forward_mp_uniform, rounding_strategy::backward_mp_uniform, rounding_strategy::random_order_mp}) {
+      PortfolioRoundingSolver<solver_type> s(options);
+      s.set_rounding_portfolio({strategy});
+      build_chain(s.GetLP(), 500);
+      s.Solve();
+      test(s.lower_bound() == plain.lower_bound());
+      test(std::isfinite(s.primal_cost()));
+      test(s.primal_cost() >= s.lower_bound() - eps);
+   }
+}
@@ -3,6 +3,9 @@
 #include "solver.hxx"
 #include "visitors/standard_visitor.hxx"
 #include "test.h"
+#include <numeric>
+#include <algorithm>
+#include <cstdint>
 
 using namespace LP_MP;
 
@@ -19,6 +22,23 @@ int main(int argc, char** argv)
 
   s.GetLP().write_back_reparametrization();
   test(std::abs(s.GetLP().original_factors_lower_bound() - 1.0) <= eps);
-}
-
 
+  // labelings are stored as bitset in the buffer FWMAP provides, identical labelings are stored identically
+  {
+    labeling_bitset b(130);
+    test(b.size_in_bytes() == 3*sizeof(std::uint64_t));
+    std::vector<char> y0(b.size_in_bytes() + 1), y1(b.size_in_bytes()), y2(b.size_in_bytes());
+    b.write({0, 64, 129}, y0.data() + 1); // buffers need not be aligned
+    b.write({1, 65}, y1.data());
+    b.write({129, 0, 64}, y2.data());
+    test(std::equal(y2.begin(), y2.end(), y0.begin() + 1));
+
+    std::vector<double> w(130, 2.0);
+    b.copy(y0.data() + 1, w.data());
+    test(std::accumulate(w.begin(), w.end(), 0.0) == 3.0);
+    test(w[0] == 1.0 && w[64] == 1.0 && w[129] == 1.0);
+    std::iota(w.begin(), w.end(), 0.0);
+    test(b.dot_product(y1.data(), w.data()) == 66.0);
+    test(b.dot_product(y0.data() + 1, w.data()) == 193.0);
+  }
+}
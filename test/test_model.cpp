@@ -6,6 +6,8 @@
 #include "LP_external_interface.hxx"
 #include "test_model.hxx"
 #include <random>
+#include <fstream>
+#include <limits>
 
 using namespace LP_MP; 
 
@@ -47,6 +49,57 @@ int main()
         s.GetLP().get_external_solver().write_to_file("test_problem.lp");
     }
 
+    // streaming export writes the same model without constructing it in the external solver
+    {
+        Solver<LP_external_solver<DD_ILP::problem_export, LP<test_FMC>>, StandardVisitor> s;
+        auto& lp = s.GetLP();
+        auto* f1 = lp.template add_factor<typename test_FMC::factor>(0,1);
+        auto* f2 = lp.template add_factor<typename test_FMC::factor>(1,std::numeric_limits<REAL>::infinity());
+        auto* f3 = lp.template add_factor<typename test_FMC::factor>(0,0);
+        lp.template add_message<typename test_FMC::message>(f1,f2);
+        lp.template add_message<typename test_FMC::message>(f1,f3);
+
+        lp.write_lp_file("test_problem_stream.lp");
+
+        std::ifstream file("test_problem_stream.lp");
+        std::vector<std::string> lines;
+        for(std::string line; std::getline(file, line);) { lines.push_back(line); }
+        test(lines.size() == 15);
+        test(lines[0] == "Minimize");
+        test(lines[1] == " obj: + 1 x1 + 1 x2");
+        test(lines[2] == "Subject To");
+        test(lines[3] == " c0_0: + 1 x0 + 1 x1 = 1");
+        test(lines[6] == " c1_0: + 1 x0 - 1 x2 = 0");
+        test(lines[9] == " c1_3: + 1 x1 - 1 x5 = 0");
+        test(lines[10] == "Bounds");
+        test(lines[11] == " x3 = 0");
+        test(lines[12] == "Binary");
+        test(lines[13] == " x0 x1 x2 x3 x4 x5");
+        test(lines[14] == "End");
+    }
+
+    // rows are generated in chunks of factors resp. messages, named after their chunk independently of the number of threads
+    {
+        Solver<LP_external_solver<DD_ILP::problem_export, LP<test_FMC>>, StandardVisitor> s;
+        auto& lp = s.GetLP();
+        const std::size_t n = 3000;
+        std::vector<typename test_FMC::factor*> f;
+        for(std::size_t i=0; i<n; ++i) { f.push_back(lp.template add_factor<typename test_FMC::factor>(i%2,(i+1)%2)); }
+        for(std::size_t i=0; i+1<n; ++i) { lp.template add_message<typename test_FMC::message>(f[i],f[i+1]); }
+
+        lp.write_lp_file("test_problem_stream.lp");
+
+        std::ifstream file("test_problem_stream.lp");
+        std::vector<std::string> rows;
+        for(std::string line; std::getline(file, line);) {
+            if(line.compare(0, 2, " c") == 0) { rows.push_back(line); }
+        }
+        test(rows.size() == n + 2*(n-1));
+        test(rows[1024] == " c1_0: + 1 x2048 + 1 x2049 = 1");
+        test(rows[n] == " c3_0: + 1 x0 - 1 x2 = 0");
+        test(rows.back() == " c5_1901: + 1 x5997 - 1 x5999 = 0");
+    }
+
    {
        //Solver<LP<test_FMC>, StandardVisitor> s;
        //auto& lp = s.GetLP();
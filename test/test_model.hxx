@@ -2,6 +2,8 @@
 #define LP_MP_TEST_MODEL_HXX 
 
 #include <array>
+#include <random>
+#include <vector>
 #include "config.hxx"
 #include "factors_messages.hxx"
 #include "tree_decomposition.hxx"
@@ -175,6 +177,40 @@ void build_test_model(LP_TYPE& lp)
   }
 }
 
+// chain of test factors with random costs. Factor and message types are taken from the FMC of the LP
+template<typename LP_TYPE>
+void build_chain(LP_TYPE& lp, const std::size_t n)
+{
+  using FMC = typename LP_TYPE::FMC;
+  std::mt19937 gen(n);
+  std::uniform_real_distribution<REAL> cost(-1.0, 1.0);
+  std::vector<typename FMC::factor*> f;
+  for(std::size_t i=0; i<n; ++i) {
+    f.push_back(lp.template add_factor<typename FMC::factor>(cost(gen), cost(gen)));
+  }
+  for(std::size_t i=0; i+1<n; ++i) {
+    lp.template add_message<typename FMC::message>(f[i], f[i+1]);
+  }
+}
+
+// grid of test factors, connected to their right and lower neighbours
+template<typename LP_TYPE>
+void build_grid(LP_TYPE& lp, const std::size_t width, const std::size_t height)
+{
+  using FMC = typename LP_TYPE::FMC;
+  std::mt19937 gen(width*height);
+  std::uniform_real_distribution<REAL> cost(-1.0, 1.0);
+  std::vector<typename FMC::factor*> f;
+  for(std::size_t i=0; i<width*height; ++i) {
+    f.push_back(lp.template add_factor<typename FMC::factor>(cost(gen), cost(gen)));
+  }
+  for(std::size_t y=0; y<height; ++y) {
+    for(std::size_t x=0; x<width; ++x) {
+      if(x+1 < width) { lp.template add_message<typename FMC::message>(f[y*width + x], f[y*width + x+1]); }
+      if(y+1 < height) { lp.template add_message<typename FMC::message>(f[y*width + x], f[(y+1)*width + x]); }
+    }
+  }
+}
 
 } // namespace LP_MP 
 
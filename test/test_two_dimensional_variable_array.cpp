@@ -4,7 +4,7 @@
 
 using namespace LP_MP;
 
-template<typename T>
+template<typename T, typename ARRAY = two_dim_variable_array<T>>
 void test_two_dimensional_variable_array(T val_1, T val_2)
 {
    // random vector tests
@@ -18,7 +18,7 @@ void test_two_dimensional_variable_array(T val_1, T val_2)
          x = dist(gen);
       }
 
-      two_dim_variable_array<T> array(size.begin(), size.begin() + size.size()/2, val_1);
+      ARRAY array(size.begin(), size.begin() + size.size()/2, val_1);
       test(array.size() == size.size()/2);
       {
          auto it = array.begin();
@@ -53,9 +53,79 @@ void test_two_dimensional_variable_array(T val_1, T val_2)
             }
          }
       }
+
+      ARRAY uninitialized_array(uninitialized, size.begin(), size.end());
+      test(uninitialized_array.size() == size.size());
+      {
+         auto size_it = uninitialized_array.size_begin();
+         for(std::size_t i=0; i<uninitialized_array.size(); ++i, ++size_it) {
+            test(uninitialized_array[i].size() == size[i]);
+            test(*size_it == size[i]);
+         }
+         test(size_it == uninitialized_array.size_end());
+      }
    } 
 }
 
+template<typename T, std::size_t ROW_ALIGNMENT>
+void test_row_alignment()
+{
+   aligned_two_dim_variable_array<T, ROW_ALIGNMENT, std::uint32_t> array(std::vector<std::size_t>({3,0,1,ROW_ALIGNMENT,7}));
+   for(std::size_t i=0; i<array.size(); ++i) {
+      test(reinterpret_cast<std::uintptr_t>(array[i].begin()) % (ROW_ALIGNMENT*sizeof(T)) == 0);
+   }
+   test(array[0].size() == 3 && array[1].size() == 0 && array[2].size() == 1 && array[3].size() == ROW_ALIGNMENT && array[4].size() == 7);
+
+   auto rit = array.rbegin();
+   for(std::size_t i=0; i<array.size(); ++i, ++rit) {
+      test((*rit).begin() == array[array.size()-1-i].begin());
+      test((*rit).size() == array[array.size()-1-i].size());
+   }
+   test(rit == array.rend());
+}
+
+void test_offset_overflow()
+{
+   std::vector<std::size_t> size = {std::numeric_limits<std::uint8_t>::max(), 1};
+   bool thrown = false;
+   try {
+      two_dim_variable_array<unsigned char, std::uint8_t> array(uninitialized, size);
+   } catch(const std::overflow_error&) {
+      thrown = true;
+   }
+   test(thrown);
+}
+
+void test_adaptive_offsets()
+{
+   // decided from the sizes alone, hence no 4 GB allocation is needed
+   const std::size_t max = std::numeric_limits<std::uint32_t>::max();
+   const std::vector<std::size_t> fitting = {max/2, max - max/2};
+   const std::vector<std::size_t> too_large = {max/2, max - max/2, 1};
+   test(adaptive_two_dim_variable_array<double>::compact_offsets_suffice(fitting.begin(), fitting.end()));
+   test(!adaptive_two_dim_variable_array<double>::compact_offsets_suffice(too_large.begin(), too_large.end()));
+
+   std::vector<std::size_t> size = {3,0,5,1};
+   adaptive_two_dim_variable_array<double> array(size.begin(), size.end(), 1.0);
+   test(array.compact() && array.size() == size.size());
+   for(std::size_t i=0; i<array.size(); ++i) {
+      test(array[i].size() == size[i]);
+      for(std::size_t j=0; j<array[i].size(); ++j) {
+         array(i,j) = double(i + j);
+      }
+   }
+   // rows have the same slice type for either offset type
+   std::size_t i = 0;
+   array.visit([&](auto& a) {
+      for(auto it = a.begin(); it != a.end(); ++it, ++i) {
+         array_slice<double> row = *it;
+         test(row.size() == size[i]);
+         for(std::size_t j=0; j<row.size(); ++j) { test(row[j] == double(i + j)); }
+      }
+   });
+   test(i == size.size());
+}
+
 int main(int argc, char** argv)
 {
    
@@ -63,5 +133,16 @@ int main(int argc, char** argv)
    test_two_dimensional_variable_array<float>(1.0, 2.0);
    test_two_dimensional_variable_array<std::size_t>(1, 2);
    test_two_dimensional_variable_array<unsigned char>(1, 2); 
+
+   test_two_dimensional_variable_array<double, compact_two_dim_variable_array<double>>(1.0, 2.0);
+   test_two_dimensional_variable_array<unsigned char, compact_two_dim_variable_array<unsigned char>>(1, 2);
+   test_two_dimensional_variable_array<double, aligned_two_dim_variable_array<double,4>>(1.0, 2.0);
+   test_two_dimensional_variable_array<float, aligned_two_dim_variable_array<float,8,std::uint32_t>>(1.0, 2.0);
+
+   test_row_alignment<double,4>();
+   test_row_alignment<float,16>();
+
+   test_offset_overflow();
+   test_adaptive_offsets();
 }
 
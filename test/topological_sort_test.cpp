@@ -0,0 +1,44 @@
+#include "test.h"
+#include "topological_sort.hxx"
+
+using namespace LP_MP;
+
+int main(int argc, char** argv)
+{
+   // diamond 0 -> {1,2} -> 3 and 4 -> 3
+   {
+      Topological_Sort::Graph g(5);
+      g.addEdge(0,1);
+      g.addEdge(0,2);
+      g.addEdge(1,3);
+      g.addEdge(2,3);
+      g.addEdge(4,3);
+      const auto order = g.topologicalSort();
+      test(order == std::vector<INDEX>({0,4,1,2,3}));
+
+      const auto& wavefronts = g.wavefronts();
+      test(wavefronts.size() == 3);
+      test(wavefronts[0].size() == 2 && wavefronts[0][0] == 0 && wavefronts[0][1] == 4);
+      test(wavefronts[1].size() == 2 && wavefronts[1][0] == 1 && wavefronts[1][1] == 2);
+      test(wavefronts[2].size() == 1 && wavefronts[2][0] == 3);
+   }
+
+   // cycle 1 -> 2 -> 3 -> 1 behind source 0
+   {
+      Topological_Sort::Graph g(4);
+      g.addEdge(0,1);
+      g.addEdge(1,2);
+      g.addEdge(2,3);
+      g.addEdge(3,1);
+      bool thrown = false;
+      try {
+         g.topologicalSort();
+      } catch(const std::runtime_error& e) {
+         thrown = true;
+         const std::string msg = e.what();
+         test(msg.find("3 of 4 nodes") != std::string::npos);
+         test(msg.find("1 -> 2 -> 3 -> 1") != std::string::npos || msg.find("2 -> 3 -> 1 -> 2") != std::string::npos || msg.find("3 -> 1 -> 2 -> 3") != std::string::npos);
+      }
+      test(thrown);
+   }
+}
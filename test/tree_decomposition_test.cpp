@@ -0,0 +1,182 @@
+#include "test.h"
+#include "test_model.hxx"
+#include <random>
+#include <cmath>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <sstream>
+
+using namespace LP_MP;
+
+struct test_subgradient_ascent : public LP_subgradient_ascent<test_FMC> {
+   using LP_subgradient_ascent<test_FMC>::LP_subgradient_ascent;
+   using LP_subgradient_ascent<test_FMC>::trees_;
+   void construct_decomposition() { LP_with_trees<test_FMC, Lagrangean_factor_star, LP_subgradient_ascent<test_FMC>>::construct_decomposition(); }
+};
+
+int main(int argc, char** argv)
+{
+   // every message must be covered by exactly one tree and trees must not exceed the maximum size
+   {
+      TCLAP::CmdLine cmd("tree decomposition test");
+      test_subgradient_ascent lp(cmd);
+      build_grid(lp, 20, 15);
+      const std::size_t max_tree_size = 50;
+      lp.build_tree_decomposition(max_tree_size);
+
+      std::set<std::pair<FactorTypeAdapter*, FactorTypeAdapter*>> tree_messages;
+      std::set<FactorTypeAdapter*> tree_factors;
+      std::size_t no_tree_messages = 0;
+      for(auto& t : lp.trees_) {
+         t.populate_factors();
+         test(t.factors_.size() <= max_tree_size);
+         tree_factors.insert(t.factors_.begin(), t.factors_.end());
+         for(auto& tree_msg : t.tree_messages_) {
+            std::visit([&](auto&& m) { tree_messages.insert({m.GetLeftFactor(), m.GetRightFactor()}); }, std::get<0>(tree_msg));
+            ++no_tree_messages;
+         }
+      }
+      test(lp.trees_.size() > 1);
+      test(no_tree_messages == lp.GetNumberOfMessages());
+      test(tree_messages.size() == lp.GetNumberOfMessages());
+      for(std::size_t i=0; i<lp.GetNumberOfMessages(); ++i) {
+         test(tree_messages.count({lp.GetMessage(i).left, lp.GetMessage(i).right}) == 1);
+      }
+      test(tree_factors.size() == lp.GetNumberOfFactors());
+   }
+
+   // tree shaped models are split into at least two trees sharing factors, also with the default maximum tree size
+   {
+      TCLAP::CmdLine cmd("tree decomposition test");
+      test_subgradient_ascent lp(cmd);
+      build_chain(lp, 51);
+      for(INDEX iter=0; iter<5; ++iter) { lp.ComputePass(iter); }
+      test(lp.trees_.size() > 1);
+      for(auto& t : lp.trees_) { test(t.factors_.size() <= 26); }
+      test(lp.no_Lagrangean_vars() > 0);
+      test(std::isfinite(lp.LowerBound()));
+   }
+
+   // models that cannot be split into two trees are rejected
+   {
+      TCLAP::CmdLine cmd("tree decomposition test");
+      test_subgradient_ascent lp(cmd);
+      build_chain(lp, 2);
+      bool thrown = false;
+      try {
+         lp.ComputePass(0);
+      } catch(const std::runtime_error&) { thrown = true; }
+      test(thrown);
+   }
+
+   // without trees given, the decomposition is built automatically
+   {
+      TCLAP::CmdLine cmd("tree decomposition test");
+      test_subgradient_ascent lp(cmd);
+      build_grid(lp, 10, 10);
+      for(INDEX iter=0; iter<5; ++iter) { lp.ComputePass(iter); }
+      test(lp.trees_.size() > 1);
+      const REAL lb = lp.LowerBound();
+      test(std::isfinite(lb));
+
+      // Lagrangean variables are added directly to the contiguous costs of test factors
+      std::mt19937 gen(0);
+      std::uniform_real_distribution<double> weight(-1.0, 1.0);
+      std::vector<double> w(lp.no_Lagrangean_vars());
+      for(auto& x : w) { x = weight(gen); }
+      lp.add_weights(w.data(), +1.0);
+      lp.add_weights(w.data(), -1.0);
+      test(std::abs(lp.decomposition_lower_bound() - lb) <= eps);
+
+      // merged sparse subgradient agrees with mapping dense primal solutions of trees
+      sparse_subgradient_vector s;
+      lp.solve_trees(s);
+      std::vector<double> dense(lp.no_Lagrangean_vars(), 0.0);
+      for(auto& t : lp.trees_) {
+         std::vector<double> local(t.mapping().size(), 0.0);
+         for(auto& L : t.Lagrangean_factors_) { L.copy_fn(local.data()); }
+         for(std::size_t i=0; i<local.size(); ++i) { dense[t.mapping()[i]] += local[i]; }
+      }
+      test(std::is_sorted(s.begin(), s.end()));
+      test(std::size_t(std::count_if(dense.begin(), dense.end(), [](const double x) { return x != 0.0; })) == s.size());
+      for(const auto& e : s) { test(dense[e.first] == e.second); }
+   }
+
+   // all multiplier update rules increase the lower bound to the same optimum
+   {
+      std::vector<REAL> best;
+      for(const std::string method : {"standard", "polyak", "nesterov", "averaged"}) {
+         TCLAP::CmdLine cmd("tree decomposition test");
+         test_subgradient_ascent lp(cmd);
+         std::vector<std::string> args = {"tree_decomposition_test", "--subgradientMethod", method};
+         cmd.parse(args);
+         build_grid(lp, 10, 10);
+         lp.ComputePass(0);
+         const REAL initial_lb = lp.decomposition_lower_bound();
+         REAL lb = initial_lb;
+         for(INDEX iter=1; iter<300; ++iter) {
+            lp.ComputePass(iter);
+            lb = std::max(lb, lp.decomposition_lower_bound());
+         }
+         test(lb > initial_lb);
+         best.push_back(lb);
+      }
+      for(const REAL lb : best) {
+         test(std::abs(lb - best[0]) <= 1e-6);
+      }
+   }
+
+   {
+      TCLAP::CmdLine cmd("tree decomposition test");
+      test_subgradient_ascent lp(cmd);
+      std::vector<std::string> args = {"tree_decomposition_test", "--subgradientMethod", "unknown"};
+      cmd.parse(args);
+      build_grid(lp, 3, 3);
+      bool thrown = false;
+      try { lp.ComputePass(0); } catch(const std::runtime_error&) { thrown = true; }
+      test(thrown);
+   }
+
+   // multipliers exported after one solve warm-start the solve of a structurally identical instance
+   {
+      std::stringstream multipliers;
+      REAL lb;
+      {
+         TCLAP::CmdLine cmd("tree decomposition test");
+         test_subgradient_ascent lp(cmd);
+         build_grid(lp, 10, 10);
+         for(INDEX iter=0; iter<100; ++iter) { lp.ComputePass(iter); }
+         sparse_subgradient_vector s;
+         lb = lp.solve_trees(s);
+         lp.export_multipliers(multipliers);
+      }
+      {
+         TCLAP::CmdLine cmd("tree decomposition test");
+         test_subgradient_ascent lp(cmd);
+         build_grid(lp, 10, 10);
+         lp.construct_decomposition();
+         sparse_subgradient_vector s;
+         test(lp.solve_trees(s) < lb - eps);
+         lp.import_multipliers(multipliers);
+         test(std::abs(lp.solve_trees(s) - lb) <= 1e-6);
+      }
+      {
+         TCLAP::CmdLine cmd("tree decomposition test");
+         test_subgradient_ascent lp(cmd);
+         build_grid(lp, 10, 9);
+         lp.construct_decomposition();
+         multipliers.seekg(0);
+         bool thrown = false;
+         try { lp.import_multipliers(multipliers); } catch(const std::runtime_error&) { thrown = true; }
+         test(thrown);
+      }
+   }
+
+   {
+      test_FMC::factor f(1.0, 2.0);
+      test(f.dual_span() == f.GetFactor()->cost.begin());
+      test(f.dual_size() == 2);
+   }
+}
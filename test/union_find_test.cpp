@@ -0,0 +1,39 @@
+#include "test.h"
+#include "union_find.hxx"
+#include <random>
+#include <vector>
+#include <array>
+
+using namespace LP_MP;
+
+int main(int argc, char** argv)
+{
+   // concurrent union find must give the same partition as the sequential one
+   const std::size_t N = 100000;
+   std::mt19937 gen(0);
+   std::uniform_int_distribution<std::size_t> dist(0, N-1);
+   std::vector<std::array<std::size_t,2>> pairs(N/2);
+   for(auto& p : pairs) { p = {dist(gen), dist(gen)}; }
+
+   union_find uf(N);
+   for(const auto& p : pairs) { uf.merge(p[0], p[1]); }
+
+   concurrent_union_find cuf(N);
+#pragma omp parallel for
+   for(std::size_t k=0; k<pairs.size(); ++k) { cuf.merge(pairs[k][0], pairs[k][1]); }
+
+   const std::size_t count = uf.count();
+   test(count == cuf.count());
+   for(const auto& p : pairs) { test(cuf.connected(p[0], p[1])); }
+
+   const auto ids = uf.get_contiguous_ids();
+   const auto concurrent_ids = cuf.get_contiguous_ids();
+   std::vector<std::size_t> id_map(count, std::numeric_limits<std::size_t>::max());
+   for(std::size_t i=0; i<N; ++i) {
+      const std::size_t id = ids[uf.find(i)];
+      const std::size_t concurrent_id = concurrent_ids[cuf.find(i)];
+      test(id < count && concurrent_id < count);
+      if(id_map[id] == std::numeric_limits<std::size_t>::max()) { id_map[id] = concurrent_id; }
+      test(id_map[id] == concurrent_id);
+   }
+}